@@ -0,0 +1,59 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary instance cache stored next to the .tsp file (<instance>.bin). It
+// holds a header, the coordinates (if any) and the raw distance matrix, laid out so
+// the matrix can be used in place from a read-only mmap of the file. The
+// header carries a hash of the source file, so an edited instance simply
+// misses the cache and gets it rewritten.
+constexpr char cache_magic[8] = {'D', 'T', 'S', 'P', 'B', 'I', 'N', '\0'};
+constexpr uint32_t cache_version = 2;
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t element_size; // sizeof the stored distance type
+	uint32_t triangular;   // 1 - packed triangle, 0 - full padded matrix
+	uint32_t weight_type; // EdgeWeightType
+	uint32_t n;
+	uint32_t coords_count; // 0 for EXPLICIT instances
+	uint64_t source_hash; // FNV-1a of the .tsp file
+	uint64_t coords_offset;
+	uint64_t matrix_offset;
+	uint64_t matrix_bytes;
+};
+
+// Read-only, shared memory mapping of a whole file. Distance matrices viewing
+// the mapping keep it alive through the shared_ptr.
+class MappedFile {
+  public:
+	static std::shared_ptr<MappedFile> open(const std::string &);
+	MappedFile(const char *, std::size_t);
+	~MappedFile();
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const char *data() const { return base; }
+	std::size_t size() const { return length; }
+
+  private:
+	const char *base;
+	std::size_t length;
+};
+
+std::string cache_path(const std::string &);
+uint64_t hash_file(const std::string &);
+bool valid_cache_header(const CacheHeader &, uint64_t, std::size_t);
+bool read_cache_header(const std::string &, uint64_t, CacheHeader &);
+bool write_cache_file(const std::string &, CacheHeader,
+					  const std::vector<double> &, const std::vector<double> &,
+					  const void *);
+
+#endif // CACHE_H
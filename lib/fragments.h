@@ -0,0 +1,34 @@
+#ifndef FRAGMENTS_H
+#define FRAGMENTS_H
+
+#pragma once
+#include <array>
+#include <vector>
+
+// Vertex-disjoint paths over n vertices, initially n single vertices, that
+// are joined end to end. Each endpoint stores the other end of its path and
+// the path size, so telling whether two endpoints belong to the same path
+// and joining two paths are O(1) - the endpoint arrays do the job of a
+// union-find.
+class Fragments {
+  public:
+	explicit Fragments(int);
+
+	bool endpoint(int v) const { return degree[v] < 2; }
+	// u and v are endpoints of two different paths
+	bool joinable(int u, int v) const {
+		return endpoint(u) && endpoint(v) && end[u] != v && u != v;
+	}
+	void join(int, int); // adds edge (u, v), joinable(u, v) must hold
+	int other_end(int v) const { return end[v]; }
+	int size(int v) const { return length[v]; } // of the path of endpoint v
+	std::vector<int> path(int) const; // from endpoint v to the other end
+
+  private:
+	std::vector<int> end;	 // per endpoint, the other end of its path
+	std::vector<int> length; // per endpoint, the number of path vertices
+	std::vector<int> degree;
+	std::vector<std::array<int, 2>> links; // path neighbours, -1 - none
+};
+
+#endif // FRAGMENTS_H
@@ -0,0 +1,34 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#pragma once
+#include <vector>
+
+// Binary max-heap over the ids 0..n-1 with a key per id. The position of
+// every id is tracked, so the key of an id can be changed or the id removed
+// in O(log n). Equal keys are ordered by the smaller id.
+class IndexedHeap {
+  public:
+	explicit IndexedHeap(int n = 0) : position(n, -1), keys(n) {}
+
+	bool empty() const { return heap.empty(); }
+	bool contains(int id) const { return position[id] >= 0; }
+	int top() const { return heap.front(); }
+	double key(int id) const { return keys[id]; }
+	void set(int, double); // inserts the id or changes its key
+	void erase(int);
+
+  private:
+	bool before(int a, int b) const {
+		return keys[a] > keys[b] || (keys[a] == keys[b] && a < b);
+	}
+	void place(int, int);
+	void sift_up(int);
+	void sift_down(int);
+
+	std::vector<int> heap;
+	std::vector<int> position; // per id, -1 outside the heap
+	std::vector<double> keys;
+};
+
+#endif // INDEXED_HEAP_H
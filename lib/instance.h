@@ -0,0 +1,28 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+// TSPLIB EDGE_WEIGHT_TYPEs understood by the parser.
+enum class EdgeWeightType { euc_2d, ceil_2d, att, geo, explicit_weights };
+
+// A parsed TSPLIB instance: the header fields we need plus either node
+// coordinates or, for EXPLICIT instances, the full weight matrix.
+class Instance {
+  public:
+	bool load_from_path(const std::string &);
+	int calc_distance(int, int) const;
+	std::pair<int, int> distance_range() const;
+	int size() const { return dimension; }
+
+	int dimension = 0;
+	EdgeWeightType weight_type = EdgeWeightType::euc_2d;
+	std::vector<double> x_coord;
+	std::vector<double> y_coord;
+	std::vector<int> weights; // row-major n x n, EXPLICIT instances only
+};
+
+#endif // INSTANCE_H
@@ -2,21 +2,128 @@
 #define MATRIX_H
 
 #pragma once
+#include "instance.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <string>
+#include <thread>
 #include <vector>
 
-class Matrix {
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Returns a zero-initialised buffer of `count` elements aligned to a cache
+// line, so that every row of DistMatrix starts on a cache line boundary.
+template <typename T> std::shared_ptr<T> make_aligned(std::size_t count) {
+	T *p = static_cast<T *>(
+		::operator new(count * sizeof(T), std::align_val_t(64)));
+	std::fill(p, p + count, T());
+	return std::shared_ptr<T>(
+		p, [](T *p) { ::operator delete(p, std::align_val_t(64)); });
+}
+
+// Flat row-major n x n distance matrix kept in one aligned block. Rows are
+// padded up to a whole number of cache lines (`stride`), so d(i, j) costs one
+// multiply-add and a single load. `T` is the stored element type.
+template <typename T> class DistMatrix {
+  public:
+	static constexpr int line = 64 / sizeof(T); // elements per cache line
+	static constexpr bool triangular = false;
+
+	DistMatrix() = default;
+	explicit DistMatrix(int n) : DistMatrix(n, make_aligned<T>(elements(n))) {}
+	// Views `values` (e.g. a memory-mapped cache) instead of owning storage.
+	DistMatrix(int n, std::shared_ptr<T> values)
+		: n(n), stride(padded(n)), values(std::move(values)) {}
+
+	T operator()(int i, int j) const {
+		return values.get()[static_cast<std::size_t>(i) * stride + j];
+	}
+	T &operator()(int i, int j) {
+		return values.get()[static_cast<std::size_t>(i) * stride + j];
+	}
+	const T *row(int i) const {
+		return values.get() + static_cast<std::size_t>(i) * stride;
+	}
+	T *row(int i) {
+		return values.get() + static_cast<std::size_t>(i) * stride;
+	}
+	int row_size(int) const { return n; }
+	int size() const { return n; }
+	const T *data() const { return values.get(); }
+	static std::size_t elements(int n) {
+		return static_cast<std::size_t>(n) * padded(n);
+	}
+
+  private:
+	static int padded(int n) { return (n + line - 1) / line * line; }
+
+	int n = 0;
+	int stride = 0;
+	std::shared_ptr<T> values;
+};
+
+// Packed triangular storage for symmetric metrics: row i keeps d(i, j) for
+// j <= i only, so the whole matrix takes n(n+1)/2 elements. The accessor maps
+// (i, j) through min/max, which compile to conditional moves, not branches.
+template <typename T> class TriangularMatrix {
   public:
+	static constexpr bool triangular = true;
+
+	TriangularMatrix() = default;
+	explicit TriangularMatrix(int n)
+		: TriangularMatrix(n, make_aligned<T>(elements(n))) {}
+	// Views `values` (e.g. a memory-mapped cache) instead of owning storage.
+	TriangularMatrix(int n, std::shared_ptr<T> values)
+		: n(n), values(std::move(values)) {}
+
+	T operator()(int i, int j) const {
+		return values.get()[offset(std::max(i, j)) + std::min(i, j)];
+	}
+	T &operator()(int i, int j) {
+		return values.get()[offset(std::max(i, j)) + std::min(i, j)];
+	}
+	const T *row(int i) const { return values.get() + offset(i); }
+	T *row(int i) { return values.get() + offset(i); }
+	int row_size(int i) const { return i + 1; }
+	int size() const { return n; }
+	const T *data() const { return values.get(); }
+	static std::size_t elements(int n) { return offset(n); }
+
+  private:
+	static std::size_t offset(int i) {
+		return static_cast<std::size_t>(i) * (i + 1) / 2;
+	}
+
+	int n = 0;
+	std::shared_ptr<T> values;
+};
+
+// Instance data plus its distance matrix. Distances are stored as `T`
+// (uint16_t for kroA/kroB-sized instances, int32_t otherwise), but always read
+// back as int so the search code keeps doing signed arithmetic. `Storage` is
+// either the full DistMatrix or the packed TriangularMatrix.
+template <typename T, template <typename> class Storage = DistMatrix>
+class Matrix : public Instance {
+  public:
+	using value_type = T;
+
 	Matrix();
-	void load_from_path(std::string);
 	void generate_dist_matrix();
-	int calc_distance(int, int, int, int);
-	std::vector<int> x_coord;
-	std::vector<int> y_coord;
-	std::vector<std::vector<int>> dist_matrix;
+	void fill_row(int);
+	bool map_cache(const std::string &, uint64_t);
+	void write_cache(const std::string &, uint64_t) const;
+	int operator()(int i, int j) const { return dist_matrix(i, j); }
+	Storage<T> dist_matrix;
 };
 
 #endif // MATRIX_H
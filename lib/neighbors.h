@@ -0,0 +1,93 @@
+#ifndef NEIGHBORS_H
+#define NEIGHBORS_H
+
+#pragma once
+#include "instance.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Uniform grid over the node coordinates, about two points per cell. Nearest
+// queries scan rings of cells around the query point and stop once no
+// farther ring can hold anything closer, so on uniform-ish instances they
+// touch O(1 + k) cells instead of all n points. Points can be removed, which
+// lets constructors query the nearest *unvisited* vertex or the cheapest
+// vertex to insert between two others; once three quarters of the points
+// are gone the grid is rebuilt over the rest, so queries do not crawl
+// through empty cells. It needs planar coordinates for every node, so
+// callers skip it for GEO and EXPLICIT instances.
+class SpatialGrid {
+  public:
+	SpatialGrid() = default;
+	SpatialGrid(const std::vector<double> &, const std::vector<double> &);
+
+	int nearest(double, double) const;
+	int nearest_to_both(int, int) const; // least sum of distances to a, b
+	void k_nearest(int, int, std::vector<int> &) const;
+	void remove(int);
+	bool contains(int v) const { return slot[v] >= 0; }
+	int size() const { return live; }
+
+  private:
+	void build(const std::vector<int> &);
+	int cell_of(double, double) const;
+	double ring_clearance(int) const;
+	template <typename Visit> void visit_ring(int, int, int, Visit) const;
+
+	const double *x = nullptr;
+	const double *y = nullptr;
+	double min_x = 0, min_y = 0;
+	double cell_w = 1, cell_h = 1;
+	int cols = 1, rows = 1;
+	int live = 0;
+	std::vector<int> cell_start; // CSR offsets of each cell in `items`
+	std::vector<int> cell_count; // points still present in each cell
+	std::vector<int> items;		 // point ids grouped by cell
+	std::vector<int> slot;		 // index of each point in `items`, -1 if gone
+};
+
+// The k nearest neighbours of every vertex, nearest first, kept in one flat
+// n x k array. Planar instances are served by SpatialGrid; GEO and EXPLICIT
+// instances fall back to a partial sort of each row of distances. The rows
+// are read through the distance source (a Matrix or DistanceOracle), since
+// a cached EXPLICIT matrix no longer keeps the parsed weights.
+class CandidateLists {
+  public:
+	CandidateLists() = default;
+	template <typename Distances>
+	CandidateLists(const Distances &distances, int neighbours) {
+		if (from_grid(distances, neighbours)) {
+			return;
+		}
+		const int n = distances.size();
+		std::vector<std::pair<int, int>> row;
+		for (int v = 0; v < n; v++) {
+			row.clear();
+			for (int u = 0; u < n; u++) {
+				if (u != v) {
+					row.push_back({static_cast<int>(distances(v, u)), u});
+				}
+			}
+			std::partial_sort(row.begin(), row.begin() + k, row.end());
+			for (int i = 0; i < k; i++) {
+				lists[static_cast<std::size_t>(v) * k + i] = row[i].second;
+			}
+		}
+	}
+
+	const int *of(int v) const {
+		return lists.data() + static_cast<std::size_t>(v) * k;
+	}
+	bool contains(int v, int u) const;
+	int neighbours() const { return k; }
+	bool empty() const { return lists.empty(); }
+
+  private:
+	// sizes the lists and fills them from a grid; false for GEO / EXPLICIT
+	bool from_grid(const Instance &, int);
+
+	int k = 0;
+	std::vector<int> lists;
+};
+
+#endif // NEIGHBORS_H
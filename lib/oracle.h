@@ -0,0 +1,25 @@
+#ifndef ORACLE_H
+#define ORACLE_H
+
+#pragma once
+#include "instance.h"
+#include <cmath>
+
+// Distance source for instances too large for any stored matrix (100k+
+// nodes): every lookup recomputes the distance from the x_coord / y_coord
+// arrays. EUC_2D is inlined here, other metrics go through calc_distance.
+// It offers the same size() / operator()(i, j) interface as Matrix, so TSP
+// runs on it unchanged.
+class DistanceOracle : public Instance {
+  public:
+	int operator()(int i, int j) const {
+		if (weight_type != EdgeWeightType::euc_2d) {
+			return calc_distance(i, j);
+		}
+		double dx = x_coord[i] - x_coord[j];
+		double dy = y_coord[i] - y_coord[j];
+		return static_cast<int>(std::sqrt(dx * dx + dy * dy) + 0.5);
+	}
+};
+
+#endif // ORACLE_H
@@ -0,0 +1,42 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing one batch of tasks at a time. The
+// workers are started once and sleep between batches, so a batch costs a
+// wake-up instead of a thread start - local search runs one per iteration.
+class ThreadPool {
+  public:
+	explicit ThreadPool(int);
+	~ThreadPool();
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	// Calls task(t) for every t in [0, tasks) and returns once all of them
+	// have finished. The calling thread takes part in the work.
+	void run(int, const std::function<void(int)> &);
+	int size() const { return workers.size() + 1; }
+
+  private:
+	void work();
+	void take_tasks();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	const std::function<void(int)> *task = nullptr;
+	int tasks = 0;
+	std::atomic<int> next_task{0};
+	int busy = 0;		 // workers still inside the current batch
+	long generation = 0; // incremented for every batch
+	bool stop = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,64 @@
+#ifndef TOUR_H
+#define TOUR_H
+
+#pragma once
+#include <vector>
+
+// Cycle over a subset of the vertices stored as a two-level list: the order
+// is cut into about sqrt(n) segments, each a small array with its own
+// reversed bit, and the segments are kept in an array in tour order (their
+// rank). A vertex maps to its segment and index, so next / prev / between
+// are O(1). Reversing a path splits at most two segments and reverses the
+// run of segments in between - O(sqrt n) amortised instead of O(n) for a
+// flat vector; the segments are rebuilt once splits have doubled their
+// number.
+class Tour {
+  public:
+	Tour() = default;
+	// `order` lists the tour, `vertices` is the number of vertex ids.
+	Tour(const std::vector<int> &order, int vertices);
+
+	int next(int v) const;
+	int prev(int v) const;
+	bool contains(int v) const { return segment_of[v] >= 0; }
+	bool between(int, int, int) const; // b on the path a -> c
+	int size() const { return count; }
+	void reverse(int, int);	 // reverses the path a -> b
+	void replace(int, int);	 // puts u, not in the tour, in place of v
+	void swap(int, int);	 // exchanges the places of two tour vertices
+	std::vector<int> order() const;
+
+  private:
+	struct Segment {
+		std::vector<int> vertices;
+		bool reversed = false;
+		int rank = 0; // index in `sequence`
+	};
+
+	int at(int s, int k) const {
+		const Segment &segment = segments[s];
+		return segment.vertices[segment.reversed
+									? segment.vertices.size() - 1 - k
+									: k];
+	}
+	int offset(int v) const { // index of v in its segment, tour direction
+		const Segment &segment = segments[segment_of[v]];
+		return segment.reversed ? segment.vertices.size() - 1 - index_of[v]
+								: index_of[v];
+	}
+	long long key(int v) const { // position in the tour
+		return static_cast<long long>(segments[segment_of[v]].rank) * count +
+			   offset(v);
+	}
+	void split(int);
+	void build(const std::vector<int> &);
+
+	std::vector<Segment> segments;
+	std::vector<int> sequence;	 // segment ids in tour order
+	std::vector<int> segment_of; // per vertex, -1 outside the tour
+	std::vector<int> index_of;	 // per vertex, index in segment.vertices
+	int count = 0;
+	int max_segments = 0;
+};
+
+#endif // TOUR_H
@@ -3,21 +3,28 @@
 
 #pragma once
 #include "matrix.h"
+#include "neighbors.h"
+#include "oracle.h"
+#include "thread_pool.h"
+#include "tour.h"
 #include <algorithm>
-#include <algorithm> // for std::shuffle
 #include <chrono>
 #include <cmath>
 #include <cstdlib> // for rand and srand
 #include <ctime>   // for time
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <numeric>
+#include <optional>
 #include <random>
 #include <set>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <unordered_set>
 #include <vector>
 
@@ -33,24 +40,75 @@ enum class AlgType {
 	hea
 };
 
-enum available {
-    NOT=-2,
-    FREE=-1,
-    // other number is current path idx
-};
-
-enum side {
-    LEFT=-1,
-    RIGHT=1
-};
-
 struct LocalSearchParams {
-	std::string input_data;		// random, regret
+	std::string input_data;		// random, regret, split
 	std::string movements_type; // vertex, edge
 	std::string filename;		// name of the file
 	int steepest;				// greedy(0), steepest(1)
-	int using_local_search;     // 0 - no, 1 - yes
+	int using_local_search = 0; // 0 - no, 1 - yes
 	int num_starts = 100;		// number of starts for multiple local search
+	int candidates = 0; // k nearest neighbours for candidate moves, 0 - all
+	int move_list = 0;	// keep improving moves between iterations (LM)
+	int threads = 1;	// threads evaluating steepest moves
+	int dont_look = 0;	// don't-look bits in greedy search
+	int or_opt = 0;		// add segment relocation (Or-opt) moves
+	int cross_exchange = 0; // longest segment swapped between cycles, 0 - off
+	int delta_cache = 0;	// reuse unaffected deltas in steepest search
+	int fragment_rebuild = 0; // HEA offspring from common edges, not regret
+	unsigned seed = 0;	// random generator seed, 0 - std::random_device
+};
+
+// Local search move: i, j are indices in the cycle (inner move) or in cycle1
+// and cycle2 respectively (inter move). Kept trivially copyable and small
+// enough to be passed in registers.
+struct Movement {
+	int i, j;
+	int8_t type;		 // inner (0), inter (1), segment relocation (2),
+						 // segment exchange (3)
+	int8_t vertex;		 // edge (0), vertex (1)
+	int8_t cycle;		 // cycle1 (0), cycle2 (1); moves inside one cycle only
+	int8_t length = 0;	 // segment moves: number of vertices moved
+	int8_t reversed = 0; // segment moves: inserted in reverse order
+};
+
+// Visits 0..size-1 once each in the order start, start + stride, ...
+// (mod size), with a random start and a random stride coprime to size. A new
+// order costs two random numbers instead of a shuffle of the whole range;
+// traversing a list shuffled once keeps consecutive orders uncorrelated.
+struct RandomTraversal {
+	RandomTraversal(int size, std::mt19937 &rng) : size(size) {
+		if (size > 1) {
+			start = rng() % size;
+			stride = 1 + rng() % (size - 1);
+			while (std::gcd(stride, size) != 1) {
+				stride = stride % (size - 1) + 1;
+			}
+		}
+	}
+	int operator[](int k) const {
+		return (start + static_cast<long long>(k) * stride) % size;
+	}
+
+	int size, start = 0, stride = 1;
+};
+
+// Improving move stored in the move list. Edge exchange (type 0) removes
+// edges (a, a_next) and (b, b_next) of one cycle; vertex swap (type 1)
+// exchanges a and b between the cycles and remembers their neighbours at
+// evaluation time. Ordered from the largest delta.
+struct ListMove {
+	int delta;
+	int type;
+	int a, a_prev, a_next;
+	int b, b_prev, b_next;
+
+	bool operator<(const ListMove &other) const {
+		if (delta != other.delta)
+			return delta > other.delta;
+		return std::tie(type, a, a_prev, a_next, b, b_prev, b_next) <
+			   std::tie(other.type, other.a, other.a_prev, other.a_next,
+						other.b, other.b_prev, other.b_next);
+	}
 };
 
 // Hash function for pairs (to use pair as key in unordered_set)
@@ -61,32 +119,42 @@ struct pair_hash {
 	}
 };
 
-class TSP {
+// MatrixT is the distance source the solver reads from (one of the Matrix
+// instantiations below or DistanceOracle); it has to provide size() and
+// operator()(i, j).
+template <typename MatrixT> class TSP {
   public:
-	TSP(const Matrix &dist_matrix, AlgType); // regular constructor
-	TSP(const Matrix &dist_matrix, AlgType, std::string input_data,
+	TSP(const MatrixT &dist_matrix, AlgType); // regular constructor
+	TSP(const MatrixT &dist_matrix, AlgType, std::string input_data,
 		std::string movements_type, int steepest,
 		std::string filename); // local search constructor
-	TSP(const Matrix &dist_matrix, AlgType, std::string input_data,
+	TSP(const MatrixT &dist_matrix, AlgType, std::string input_data,
 		std::string movements_type, int steepest, int using_local_search,
 		std::string filename); //hea constructor
+	TSP(const MatrixT &dist_matrix, AlgType, LocalSearchParams);
 
 	auto solve() -> std::tuple<std::vector<int>, std::vector<int>>;
-	const Matrix &dist_matrix;
+	const MatrixT &dist_matrix;
 	int start_idx = -1; // random start
 
   private:
 	std::vector<bool> visited =
-		std::vector<bool>(dist_matrix.x_coord.size(), false);
+		std::vector<bool>(dist_matrix.size(), false);
 	std::vector<int> cycle1, cycle2;
 	AlgType alg_type;
 	LocalSearchParams params;
+	std::mt19937 rng{std::random_device{}()}; // reseeded from params.seed
+	CandidateLists candidate_lists; // built on first candidate search
+	CandidateLists rebuild_candidates; // built on first fragment rebuild
+	std::shared_ptr<ThreadPool> pool; // started by the first run_tasks
+	std::vector<int> swap_left, swap_right, swap_base; // prepare_inter_swaps
 
 	// UTILS
 	int find_random_start();
 	int find_farthest(int);
 	int calc_distance(int, int);
 	double calc_cycles_len();
+	void run_tasks(int, const std::function<void(int)> &);
 	std::pair<int, int> choose_starting_vertices();
 	void append_vertex(int, std::vector<int> &);
 	void insert_vertex(int, int, std::vector<int> &);
@@ -104,20 +172,25 @@ class TSP {
 		-> std::tuple<std::vector<int>, std::vector<int>>;
 	auto find_greedy_cycles_regret()
 		-> std::tuple<std::vector<int>, std::vector<int>>;
+	std::optional<SpatialGrid> unvisited_grid() const;
+	void extend_nearest(std::vector<int> &, std::vector<int> &);
+	void insert_cheapest(std::vector<int> &, std::vector<int> &);
 	std::pair<int, double> find_nearest_expansion(int, int,
-												  const std::vector<bool> &);
+												  const std::vector<bool> &,
+												  const SpatialGrid * = nullptr);
 	double get_expansion_cost(int, int, int);
 	std::pair<int, int> find_nearest_neighbor(int, int,
-											  const std::vector<bool> &);
-	std::pair<int, double> get_2regret(int, std::vector<int>, float = 0.42);
+											  const std::vector<bool> &,
+											  const SpatialGrid * = nullptr);
+	void regret_insertion(std::vector<int> &, std::vector<int> &,
+						  float = 0.42);
 	std::tuple<std::vector<int>, std::vector<int>>
 	find_greedy_cycles_regret_from_incomplete(std::vector<int> &,
 											  std::vector<int> &);
     std::tuple<std::vector<int>, std::vector<int>> find_greedy_cycles_from_incomplete(std::vector<int> &, std::vector<int> &);
     std::tuple<std::vector<int>, std::vector<int>> find_greedy_cycles_nearest_from_incomplete(std::vector<int> &, std::vector<int> &);
-    std::vector<int> find_from_incomplete_degenerated_inner(std::vector<std::vector<int>> &, std::map<int, std::pair<int, int>>&);
-    std::tuple<std::vector<int>, std::vector<int>> find_from_incomplete_degenerated(std::vector<std::vector<int>> &, std::vector<std::vector<int>> &, std::map<int, std::pair<int, int>>&, std::map<int, std::pair<int, int>>&);
-    std::pair<int,int> find_neighbour(int, int, int);
+	std::tuple<std::vector<int>, std::vector<int>>
+	rebuild_from_fragments(const std::vector<std::pair<int, int>> &);
 
 	// LOCAL SEARCH
 	auto local_search() -> std::tuple<std::vector<int>, std::vector<int>>;
@@ -127,24 +200,50 @@ class TSP {
 	// auto random_walk() -> std::tuple<std::vector<int>, std::vector<int>>;
 	// void inner_class_search(std::vector<int>&, bool);
 	// void inter_class_search(bool);
-	static auto generate_all_edge_movements(int)
-		-> std::vector<std::vector<int>>;
-	static auto generate_all_vertex_movements(int)
-		-> std::vector<std::vector<int>>;
-	static auto generate_all_vertex_movements_inter(int)
-		-> std::vector<std::vector<int>>;
+	static auto generate_all_edge_movements(int, int) -> std::vector<Movement>;
+	static auto generate_all_vertex_movements(int, int)
+		-> std::vector<Movement>;
+	static auto generate_all_vertex_movements_inter(int, int)
+		-> std::vector<Movement>;
 	auto generate_random_cycles(int)
 		-> std::tuple<std::vector<int>, std::vector<int>>;
+	auto generate_split_cycles()
+		-> std::tuple<std::vector<int>, std::vector<int>>;
 	// int get_objective_value(const std::vector<int>&, std::vector<int>); //
 	// inner class int get_objective_value(std::vector<int>); // inter class
-	void update_cycle(const std::vector<int> &,
-					  std::vector<int> &); // inner class
-	void update_cycles(std::vector<int>);  // inter class
+	void update_cycle(Movement, std::vector<int> &); // inner class
+	void update_cycles(Movement);					  // inter class
 	// void random_walk_inner(std::vector<int>, int) ;
 	// void random_walk_inter(int);
-	void apply_movement(const std::vector<int> &, int);
+	void apply_movement(Movement, int);
 	void main_search(bool, bool);
-	auto get_delta(std::vector<int> movement) -> std::tuple<int, int>;
+	template <bool Steepest, bool Vertex> void search();
+	template <bool Vertex> void cached_search();
+	template <bool Vertex>
+	int inner_delta(int, int, const std::vector<int> &) const;
+	int inter_delta(int, int) const;
+	template <bool Vertex>
+	void steepest_scan(const std::vector<Movement> &,
+					   const std::vector<Movement> &, int &, Movement &);
+	void prepare_inter_swaps();
+	void best_inter_swap(int &, Movement &, int, int) const;
+	void candidate_search(bool);
+	template <bool Vertex> void dont_look_search();
+	void list_search();
+	void index_cycles(std::vector<int> &, std::vector<int> &);
+	auto get_delta(Movement) -> std::tuple<int, int>;
+
+	// LOCAL SEARCH SEGMENT MOVES
+	static constexpr int max_segment = 3;	// relocation
+	static constexpr int max_exchange = 64; // cross-exchange
+	static auto generate_all_segment_movements(int, int, bool, int)
+		-> std::vector<Movement>;
+	static bool valid_relocation(int, int, int, int);
+	int segment_delta(Movement) const;
+	void apply_segment(Movement);
+	void candidate_segment_movements(int, int, int, int,
+									 const std::vector<int> &,
+									 std::vector<Movement> &);
 
 	// LOCAL SEARCH EXTENSION
 	auto multiple_local_search()
@@ -175,7 +274,20 @@ class TSP {
 	findEdges(const std::vector<int> &);
 	
     auto remove_edges(std::vector<int>& , const std::unordered_set<std::pair<int, int>, pair_hash>&) -> std::vector<int>;
+	auto common_edges(const std::vector<int> &, const std::vector<int> &,
+					  const std::unordered_set<std::pair<int, int>, pair_hash> &)
+		-> std::vector<std::pair<int, int>>;
 	auto find_best_worst_solution(std::vector<std::tuple<std::vector<int>, std::vector<int>>>, bool) -> std::pair<int, int>;
 
 };
+
+// TSP members are spread over several source files; each of them instantiates
+// the members it defines for every supported distance storage.
+#define INSTANTIATE_TSP                                                        \
+	template class TSP<Matrix<uint16_t>>;                                      \
+	template class TSP<Matrix<int32_t>>;                                       \
+	template class TSP<Matrix<uint16_t, TriangularMatrix>>;                    \
+	template class TSP<Matrix<int32_t, TriangularMatrix>>;                     \
+	template class TSP<DistanceOracle>;
+
 #endif // TSP_H
@@ -1,13 +0,0 @@
-#ifndef UTILS_H
-#define UTILS_H
-
-#pragma once
-#include <fstream>
-#include <iostream>
-#include <sstream>
-#include <string>
-#include <vector>
-
-std::vector<std::string> splitString(const std::string &, char);
-
-#endif // UTILS_H
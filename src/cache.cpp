@@ -0,0 +1,110 @@
+#include "../lib/cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return nullptr;
+	}
+	void *base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		return nullptr;
+	}
+	return std::make_shared<MappedFile>(static_cast<const char *>(base),
+										st.st_size);
+}
+
+MappedFile::MappedFile(const char *base, std::size_t length)
+	: base(base), length(length) {}
+
+MappedFile::~MappedFile() { munmap(const_cast<char *>(base), length); }
+
+std::string cache_path(const std::string &instance_path) {
+	return instance_path + ".bin";
+}
+
+uint64_t hash_file(const std::string &path) {
+	uint64_t hash = 14695981039346656037ull;
+	auto file = MappedFile::open(path);
+	if (!file) {
+		return 0;
+	}
+	for (std::size_t i = 0; i < file->size(); i++) {
+		hash ^= static_cast<unsigned char>(file->data()[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool valid_cache_header(const CacheHeader &header, uint64_t source_hash,
+						std::size_t file_size) {
+	return std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) == 0 &&
+		   header.version == cache_version &&
+		   header.source_hash == source_hash &&
+		   header.coords_count <= header.n &&
+		   header.coords_offset + 2 * sizeof(double) * header.coords_count <=
+			   header.matrix_offset &&
+		   header.matrix_offset + header.matrix_bytes <= file_size;
+}
+
+bool read_cache_header(const std::string &path, uint64_t source_hash,
+					   CacheHeader &header) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return false;
+	}
+	std::size_t file_size = file.tellg();
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+		return false;
+	}
+	return valid_cache_header(header, source_hash, file_size);
+}
+
+// Writes the cache under a temporary name and renames it into place, so that
+// concurrent solver processes never map a half-written file.
+bool write_cache_file(const std::string &path, CacheHeader header,
+					  const std::vector<double> &x_coord,
+					  const std::vector<double> &y_coord, const void *matrix) {
+	const std::size_t alignment = 64;
+	std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = cache_version;
+	header.coords_offset = sizeof(CacheHeader);
+	const std::size_t coords_bytes = 2 * sizeof(double) * header.coords_count;
+	header.matrix_offset =
+		(header.coords_offset + coords_bytes + alignment - 1) / alignment *
+		alignment;
+
+	std::string tmp_path = path + ".tmp" + std::to_string(getpid());
+	std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+	std::vector<char> padding(
+		header.matrix_offset - header.coords_offset - coords_bytes, 0);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(x_coord.data()),
+			   sizeof(double) * header.coords_count);
+	file.write(reinterpret_cast<const char *>(y_coord.data()),
+			   sizeof(double) * header.coords_count);
+	file.write(padding.data(), padding.size());
+	file.write(static_cast<const char *>(matrix), header.matrix_bytes);
+	file.close();
+	if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+	return true;
+}
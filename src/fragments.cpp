@@ -0,0 +1,30 @@
+#include "../lib/fragments.h"
+#include <numeric>
+
+Fragments::Fragments(int n)
+	: end(n), length(n, 1), degree(n, 0), links(n, {-1, -1}) {
+	std::iota(end.begin(), end.end(), 0);
+}
+
+void Fragments::join(int u, int v) {
+	const int end_u = end[u], end_v = end[v];
+	const int joined = length[u] + length[v];
+	links[u][degree[u]++] = v;
+	links[v][degree[v]++] = u;
+	end[end_u] = end_v;
+	end[end_v] = end_u;
+	length[end_u] = length[end_v] = joined;
+}
+
+std::vector<int> Fragments::path(int v) const {
+	std::vector<int> vertices;
+	vertices.reserve(length[v]);
+	for (int previous = -1, current = v; current >= 0;) {
+		vertices.push_back(current);
+		int next = links[current][0] == previous ? links[current][1]
+												 : links[current][0];
+		previous = current;
+		current = next;
+	}
+	return vertices;
+}
@@ -1,69 +1,95 @@
+#include "../lib/fragments.h"
+#include "../lib/indexed_heap.h"
 #include "../lib/tsp.h"
 
-auto TSP::find_greedy_cycles_nearest()
+template <typename MatrixT>
+auto TSP<MatrixT>::find_greedy_cycles_nearest()
 	-> std::tuple<std::vector<int>, std::vector<int>> {
     if (!cycle1.empty() && !cycle2.empty()) {
         cycle1.clear();
         cycle2.clear();
-        visited = std::vector<bool>(dist_matrix.x_coord.size(), false);
+        visited = std::vector<bool>(dist_matrix.size(), false);
     }
 	auto start = choose_starting_vertices();
-	int current_last_vertex1 = start.first;
-	int current_last_vertex2 = start.second;
-	int current_first_vertex1 = start.first;
-	int current_first_vertex2 = start.second;
-
-	append_vertex(current_last_vertex1, cycle1);
-	append_vertex(current_last_vertex2, cycle2);
-
-	while (cycle1.size() + cycle2.size() < dist_matrix.x_coord.size()) {
-		// Find nearest neighbors for the last and first vertices in each cycle
-		auto nearest_neighbor_info1 = find_nearest_neighbor(
-			current_last_vertex1, current_first_vertex1, visited);
-		auto nearest_neighbor_info2 = find_nearest_neighbor(
-			current_last_vertex2, current_first_vertex2, visited);
-
-		int nearest_neighbor1 = nearest_neighbor_info1.first;
-		int nearest_neighbor2 = nearest_neighbor_info2.first;
-		int vertex_type1 = nearest_neighbor_info1.second;
-		int vertex_type2 = nearest_neighbor_info2.second;
+	append_vertex(start.first, cycle1);
+	append_vertex(start.second, cycle2);
+	extend_nearest(cycle1, cycle2);
+	return {cycle1, cycle2};
+}
 
-		std::vector<int> &cycle =
-			(cycle1.size() <= cycle2.size()) ? cycle1 : cycle2;
+// Grid over the vertices not visited yet, for the constructors' nearest and
+// cheapest insertion queries; none when the instance has no planar
+// coordinates (GEO, EXPLICIT) and the queries scan all vertices.
+template <typename MatrixT>
+std::optional<SpatialGrid> TSP<MatrixT>::unvisited_grid() const {
+	if (dist_matrix.x_coord.empty() ||
+		dist_matrix.weight_type == EdgeWeightType::geo) {
+		return std::nullopt;
+	}
+	SpatialGrid grid(dist_matrix.x_coord, dist_matrix.y_coord);
+	for (int v = 0; v < dist_matrix.size(); ++v) {
+		if (visited[v]) {
+			grid.remove(v);
+		}
+	}
+	return grid;
+}
 
-		// Choose the nearest neighbor to the cycle that is shorter
-		if (cycle1.size() <= cycle2.size()) {
-			if (vertex_type1 == 0) {
-				append_vertex(nearest_neighbor1, cycle);
-				current_last_vertex1 = nearest_neighbor1;
-			} else {
-				insert_vertex(nearest_neighbor1, 0, cycle);
-				current_first_vertex1 = nearest_neighbor1;
-			}
+// Nearest neighbour construction: the shorter cycle is extended at the end
+// (first or last vertex) that has the nearest unvisited vertex.
+template <typename MatrixT>
+void TSP<MatrixT>::extend_nearest(std::vector<int> &c1, std::vector<int> &c2) {
+	std::optional<SpatialGrid> grid = unvisited_grid();
+	std::deque<int> cycles[2] = {{c1.begin(), c1.end()}, {c2.begin(), c2.end()}};
+	while (cycles[0].size() + cycles[1].size() < dist_matrix.size()) {
+		std::deque<int> &cycle =
+			cycles[0].size() <= cycles[1].size() ? cycles[0] : cycles[1];
+		auto [nearest, vertex_type] =
+			find_nearest_neighbor(cycle.back(), cycle.front(), visited,
+								  grid ? &*grid : nullptr);
+		if (vertex_type == 0) {
+			cycle.push_back(nearest);
 		} else {
-			if (vertex_type2 == 0) {
-				append_vertex(nearest_neighbor2, cycle);
-				current_last_vertex2 = nearest_neighbor2;
-			} else {
-				insert_vertex(nearest_neighbor2, 0, cycle);
-				current_first_vertex2 = nearest_neighbor2;
-			}
+			cycle.push_front(nearest);
+		}
+		visited[nearest] = true;
+		if (grid) {
+			grid->remove(nearest);
 		}
 	}
-	return {cycle1, cycle2};
+	c1.assign(cycles[0].begin(), cycles[0].end());
+	c2.assign(cycles[1].begin(), cycles[1].end());
 }
 
+template <typename MatrixT>
 std::pair<int, int>
-TSP::find_nearest_neighbor(int current_last_vertex, int current_first_vertex,
-						   const std::vector<bool> &visited) {
+TSP<MatrixT>::find_nearest_neighbor(int current_last_vertex, int current_first_vertex,
+						   const std::vector<bool> &visited,
+						   const SpatialGrid *grid) {
+	if (grid) {
+		if (grid->size() == 0) {
+			return {-1, 0};
+		}
+		const std::vector<double> &x = dist_matrix.x_coord,
+								  &y = dist_matrix.y_coord;
+		int last = grid->nearest(x[current_last_vertex], y[current_last_vertex]);
+		int first =
+			grid->nearest(x[current_first_vertex], y[current_first_vertex]);
+		if (dist_matrix(current_last_vertex, last) <
+			dist_matrix(current_first_vertex, first)) {
+			return {last, 0};
+		}
+		return {first, 1};
+	}
+
 	double min_distance_last = std::numeric_limits<double>::max();
 	double min_distance_first = std::numeric_limits<double>::max();
 	int nearest_neighbor_last = -1;
 	int nearest_neighbor_first = -1;
 
-	for (size_t i = 0; i < dist_matrix.x_coord.size(); ++i) {
+	for (size_t i = 0; i < dist_matrix.size(); ++i) {
 		if (!visited[i] && i != current_last_vertex) {
-			double distance = dist_matrix.dist_matrix[current_last_vertex][i];
+			double distance = dist_matrix(current_last_vertex, i);
 
 			if (distance < min_distance_last) {
 				min_distance_last = distance;
@@ -72,7 +98,7 @@ TSP::find_nearest_neighbor(int current_last_vertex, int current_first_vertex,
 		}
 
 		if (!visited[i] && i != current_first_vertex) {
-			double distance = dist_matrix.dist_matrix[current_first_vertex][i];
+			double distance = dist_matrix(current_first_vertex, i);
 			if (distance < min_distance_first) {
 				min_distance_first = distance;
 				nearest_neighbor_first = i;
@@ -87,47 +113,110 @@ TSP::find_nearest_neighbor(int current_last_vertex, int current_first_vertex,
 	}
 }
 
-auto TSP::find_greedy_cycles_expansion()
+template <typename MatrixT>
+auto TSP<MatrixT>::find_greedy_cycles_expansion()
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	auto start = choose_starting_vertices();
 	append_vertex(start.first, cycle1);
 	append_vertex(start.second, cycle2);
+	insert_cheapest(cycle1, cycle2);
+	return {cycle1, cycle2};
+}
 
-	while (cycle1.size() + cycle2.size() < dist_matrix.x_coord.size()) {
-		std::vector<int> &cycle =
-			(cycle1.size() <= cycle2.size()) ? cycle1 : cycle2;
-
-		double min_length = std::numeric_limits<double>::max();
-		int best_candidate, best_idx = -1;
+// Greedy cycle construction: the shorter cycle gets its cheapest insertion.
+// Every edge (a, next[a]) caches its cheapest unvisited vertex in a heap per
+// cycle. An insertion changes only the edge it splits and adds one, so
+// besides those two only the edges whose cached vertex was just taken are
+// evaluated again - with the grid each evaluation touches a few cells
+// instead of all vertices.
+template <typename MatrixT>
+void TSP<MatrixT>::insert_cheapest(std::vector<int> &c1,
+								   std::vector<int> &c2) {
+	const int n = dist_matrix.size();
+	std::optional<SpatialGrid> grid = unvisited_grid();
+	std::vector<int> next(n, -1), cycle_of(n, -1), candidate(n, -1);
+	std::vector<std::vector<int>> watchers(n); // edges whose candidate is u
+	IndexedHeap cheapest[2] = {IndexedHeap(n), IndexedHeap(n)}; // -cost
+	int head[2] = {c1.front(), c2.front()};
+	int size[2] = {(int)c1.size(), (int)c2.size()};
+
+	auto evaluate = [&](int a) {
+		auto [u, cost] = find_nearest_expansion(a, next[a], visited,
+												grid ? &*grid : nullptr);
+		if (u < 0) {
+			return;
+		}
+		candidate[a] = u;
+		watchers[u].push_back(a);
+		cheapest[cycle_of[a]].set(a, -cost);
+	};
+	const std::vector<int> *cycles[2] = {&c1, &c2};
+	for (int c = 0; c < 2; ++c) {
+		const std::vector<int> &cycle = *cycles[c];
+		for (int k = 0; k < cycle.size(); ++k) {
+			next[cycle[k]] = cycle[(k + 1) % cycle.size()];
+			cycle_of[cycle[k]] = c;
+		}
+	}
+	for (int a = 0; a < n; ++a) {
+		if (cycle_of[a] >= 0) {
+			evaluate(a);
+		}
+	}
 
-		for (size_t i = 0; i < cycle.size(); ++i) {
-			int current = cycle[i];
-			int next = cycle[(i + 1) % cycle.size()];
-			auto [nearest, length] =
-				find_nearest_expansion(current, next, visited);
-			if (length < min_length) {
-				min_length = length;
-				best_candidate = nearest;
-				best_idx = i;
+	while (size[0] + size[1] < n) {
+		const int c = size[0] <= size[1] ? 0 : 1;
+		const int a = cheapest[c].top(), v = candidate[a];
+		visited[v] = true;
+		if (grid) {
+			grid->remove(v);
+		}
+		next[v] = next[a];
+		next[a] = v;
+		cycle_of[v] = c;
+		++size[c];
+
+		evaluate(a);
+		evaluate(v);
+		for (int e : watchers[v]) {
+			if (candidate[e] == v) {
+				evaluate(e);
 			}
 		}
+		std::vector<int>().swap(watchers[v]);
+	}
 
-		insert_vertex(best_candidate, (best_idx + 1) % cycle.size(), cycle);
+	for (int c = 0; c < 2; ++c) {
+		std::vector<int> &cycle = c == 0 ? c1 : c2;
+		cycle.clear();
+		int a = head[c];
+		do {
+			cycle.push_back(a);
+			a = next[a];
+		} while (a != head[c]);
 	}
-	return {cycle1, cycle2};
 }
 
-auto TSP::find_nearest_expansion(int first, int last,
-								 const std::vector<bool> &visited)
+template <typename MatrixT>
+auto TSP<MatrixT>::find_nearest_expansion(int first, int last,
+								 const std::vector<bool> &visited,
+								 const SpatialGrid *grid)
 	-> std::pair<int, double> {
 	if (first == last) {
-		return {find_nearest_neighbor(first, first, visited).first, 0.0};
+		return {find_nearest_neighbor(first, first, visited, grid).first, 0.0};
+	}
+	if (grid) {
+		int candidate = grid->nearest_to_both(first, last);
+		if (candidate < 0) {
+			return {-1, 0.0};
+		}
+		return {candidate, get_expansion_cost(first, last, candidate)};
 	}
 
 	double min_distance = std::numeric_limits<double>::max();
 	int candidate = -1;
 
-	for (size_t i = 0; i < dist_matrix.x_coord.size(); ++i) {
+	for (size_t i = 0; i < dist_matrix.size(); ++i) {
 		if (!visited[i] && i != first && i != last) {
 			double distance = get_expansion_cost(first, last, i);
 			if (distance < min_distance) {
@@ -139,452 +228,188 @@ auto TSP::find_nearest_expansion(int first, int last,
 	return {candidate, min_distance};
 }
 
-auto TSP::find_greedy_cycles_regret()
+template <typename MatrixT>
+auto TSP<MatrixT>::find_greedy_cycles_regret()
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	if (!cycle1.empty() && !cycle2.empty()) {
 		cycle1.clear();
 		cycle2.clear();
-		visited = std::vector<bool>(dist_matrix.x_coord.size(), false);
+		visited = std::vector<bool>(dist_matrix.size(), false);
 	}
 	auto start = choose_starting_vertices();
 	append_vertex(start.first, cycle1);
 	append_vertex(start.second, cycle2);
-	std::map<int, std::pair<int, double>> regrets;
-
-	while (cycle1.size() + cycle2.size() < dist_matrix.x_coord.size()) {
-		std::vector<int> &cycle =
-			(cycle1.size() <= cycle2.size()) ? cycle1 : cycle2;
-		regrets.clear();
-		for (size_t i = 0; i < dist_matrix.x_coord.size(); ++i) {
-			if (!visited[i]) {
-				regrets[i] = get_2regret(i, cycle);
-			}
-		}
-
-		int candidate = -1;
-		double max_regret = -std::numeric_limits<double>::infinity();
-		for (const auto &r : regrets) {
-			if (r.second.second > max_regret) {
-				max_regret = r.second.second;
-				candidate = r.first;
-			}
-		}
-		insert_vertex(candidate, (regrets[candidate].first + 1) % cycle.size(),
-					  cycle);
-	}
+	regret_insertion(cycle1, cycle2);
 
 	return {cycle1, cycle2};
 }
 
-auto TSP::get_2regret(int candidate, std::vector<int> cycle, float coef)
-	-> std::pair<int, double> {
-	std::vector<std::pair<int, double>> cost; // idx, distance
-	for (size_t i = 0; i < cycle.size(); ++i) {
-		double distance = get_expansion_cost(
-			cycle[i], cycle[(i + 1) % cycle.size()], candidate);
-		cost.push_back({i, distance});
-	}
-	// Find the indices of the two lowest values
-	int min_idxs[2];
-	min_idxs[0] = 0;
-	min_idxs[1] = 1;
-	if (cost[1].second < cost[min_idxs[0]].second) {
-		min_idxs[0] = 1;
-		min_idxs[1] = min_idxs[0];
-	}
-
-	for (size_t i = 2; i < cost.size(); ++i) {
-		if (cost[i].second < cost[min_idxs[0]].second) {
-			min_idxs[1] = min_idxs[0];
-			min_idxs[0] = i;
-		} else if (cost[i].second < cost[min_idxs[1]].second) {
-			min_idxs[1] = i;
-		}
-	}
-
-	double regret = cost[min_idxs[1]].second - cost[min_idxs[0]].second;
-	double weighted_regret = regret - coef * cost[min_idxs[0]].second;
-
-	return {cost[min_idxs[0]].first, weighted_regret};
-}
-
-double TSP::get_expansion_cost(int first, int last, int candidate) {
-	return dist_matrix.dist_matrix[first][candidate] +
-		   dist_matrix.dist_matrix[last][candidate] -
-		   dist_matrix.dist_matrix[first][last];
+template <typename MatrixT>
+double TSP<MatrixT>::get_expansion_cost(int first, int last, int candidate) {
+	return dist_matrix(first, candidate) +
+		   dist_matrix(last, candidate) -
+		   dist_matrix(first, last);
 }
 
-auto TSP::find_greedy_cycles_regret_from_incomplete(std::vector<int> &c1,
+template <typename MatrixT>
+auto TSP<MatrixT>::find_greedy_cycles_regret_from_incomplete(std::vector<int> &c1,
 													std::vector<int> &c2)
 	-> std::tuple<std::vector<int>, std::vector<int>> {
-	std::map<int, std::pair<int, double>> regrets;
-	visited = std::vector<bool>(dist_matrix.x_coord.size(), false);
+	visited = std::vector<bool>(dist_matrix.size(), false);
 	for (int vertex : c1)
 		visited[vertex] = true;
 	for (int vertex : c2)
 		visited[vertex] = true;
-	while (c1.size() + c2.size() < dist_matrix.x_coord.size()) {
-		std::vector<int> &cycle = (c1.size() <= c2.size()) ? c1 : c2;
-		regrets.clear();
-		for (size_t i = 0; i < dist_matrix.x_coord.size(); ++i) {
-			if (!visited[i]) {
-				regrets[i] = get_2regret(i, cycle);
-			}
-		}
-
-		int candidate = -1;
-		double max_regret = -std::numeric_limits<double>::infinity();
-		for (const auto &r : regrets) {
-			if (r.second.second > max_regret) {
-				max_regret = r.second.second;
-				candidate = r.first;
-			}
-		}
-		insert_vertex(candidate, (regrets[candidate].first + 1) % cycle.size(),
-					  cycle);
-	}
+	regret_insertion(c1, c2);
 
 	return {c1, c2};
 }
 
-auto TSP::find_greedy_cycles_from_incomplete(std::vector<int> &c1, std::vector<int> &c2) -> std::tuple<std::vector<int>, std::vector<int>> {
+template <typename MatrixT>
+auto TSP<MatrixT>::find_greedy_cycles_from_incomplete(std::vector<int> &c1, std::vector<int> &c2) -> std::tuple<std::vector<int>, std::vector<int>> {
     // Greedy cycles expansion approach
-    visited = std::vector<bool>(dist_matrix.x_coord.size(), false);
+    visited = std::vector<bool>(dist_matrix.size(), false);
     for (int vertex : c1)
         visited[vertex] = true;
     for (int vertex : c2)
         visited[vertex] = true;
-    while (c1.size() + c2.size() < dist_matrix.x_coord.size()) {
-        std::vector<int> &cycle =
-                (c1.size() <= c2.size()) ? c1 : c2;
-        double min_length = std::numeric_limits<double>::max();
-        int best_candidate, best_idx = -1;
-
-        for (size_t i = 0; i < cycle.size(); ++i) {
-            int current = cycle[i];
-            int next = cycle[(i + 1) % cycle.size()];
-            auto [nearest, length] =
-                    find_nearest_expansion(current, next, visited);
-            if (length < min_length) {
-                min_length = length;
-                best_candidate = nearest;
-                best_idx = i;
-            }
-        }
-
-        insert_vertex(best_candidate, (best_idx + 1) % cycle.size(), cycle);
-    }
+    insert_cheapest(c1, c2);
 
     return {c1, c2};
 }
 
-auto TSP::find_greedy_cycles_nearest_from_incomplete(std::vector<int> &c1, std::vector<int> &c2) -> std::tuple<std::vector<int>, std::vector<int>> {
-    visited = std::vector<bool>(dist_matrix.x_coord.size(), false);
+template <typename MatrixT>
+auto TSP<MatrixT>::find_greedy_cycles_nearest_from_incomplete(std::vector<int> &c1, std::vector<int> &c2) -> std::tuple<std::vector<int>, std::vector<int>> {
+    visited = std::vector<bool>(dist_matrix.size(), false);
     for (int vertex : c1)
         visited[vertex] = true;
     for (int vertex : c2)
         visited[vertex] = true;
-
-    int current_last_vertex1 = c1.back();
-    int current_last_vertex2 = c2.back();
-    int current_first_vertex1 = c1.front();
-    int current_first_vertex2 = c2.front();
-
-    auto handle_nearest_neighbor = [&](int &current_last_vertex, int &current_first_vertex, std::vector<int> &cycle) {
-        auto nearest_neighbor_info = find_nearest_neighbor(current_last_vertex, current_first_vertex, visited);
-        int nearest_neighbor = nearest_neighbor_info.first;
-        int vertex_type = nearest_neighbor_info.second;
-
-        if (vertex_type == 0) {
-            append_vertex(nearest_neighbor, cycle);
-            current_last_vertex = nearest_neighbor;
-        } else {
-            insert_vertex(nearest_neighbor, 0, cycle);
-            current_first_vertex = nearest_neighbor;
-        }
-    };
-
-    while (c1.size() + c2.size() < dist_matrix.x_coord.size()) {
-        if (c1.size() <= c2.size()) {
-            handle_nearest_neighbor(current_last_vertex1, current_first_vertex1, c1);
-        } else {
-            handle_nearest_neighbor(current_last_vertex2, current_first_vertex2, c2);
-        }
-    }
+    extend_nearest(c1, c2);
     return {c1, c2};
 }
 
-auto TSP::find_from_incomplete_degenerated(std::vector<std::vector<int>> &p1, std::vector<std::vector<int>> &p2,
-                                           std::map<int, std::pair<int, int>> &m1, std::map<int, std::pair<int, int>> &m2) ->   std::tuple<std::vector<int>, std::vector<int>> {
-    // Nearest neighbor approach
-    // TODO
-    return {p1.front(), p2.front()};
-}
-
-auto TSP::find_neighbour(int current_last_vertex, int current_first_vertex, int j) -> std::pair<int, int>{
-    double min_distance_last = std::numeric_limits<double>::max();
-    double min_distance_first = std::numeric_limits<double>::max();
-    int nearest_neighbor_last = -1;
-    int nearest_neighbor_first = -1;
-    double distance_last = dist_matrix.dist_matrix[current_last_vertex][j];
-    double distance_first = dist_matrix.dist_matrix[current_first_vertex][j];
-    if (distance_last < min_distance_last){
-        min_distance_last = distance_last;
-        nearest_neighbor_last = j;
-    }
-    if (distance_first < min_distance_first){
-        min_distance_first = distance_first;
-        nearest_neighbor_first = j;
-    }
-    if (min_distance_last < min_distance_first){
-        return {nearest_neighbor_last, 1};
-    } else {
-        return {nearest_neighbor_first, 0};
-    }
-}
-
-
-void calculate_current_size(std::vector<std::vector<int>> paths){
-    int s = 0;
-    for (auto path : paths){
-        s += path.size();
-    } std::cout << "||||Current size: " << s << "||||" << std::endl;
-}
-
-auto TSP::find_from_incomplete_degenerated_inner(std::vector<std::vector<int>> &paths, std::map<int, std::pair<int, int>> &visited_map) -> std::vector<int> {
-    int solution_idx = -1;
-
-	// Iterate until the solution is found
-    while(solution_idx == -1){
-
-		// Iterate over all paths
-        for (int i = 0; i < paths.size(); i++){
-
-			// If the path is already complete, break the loop
-            if (paths[i].size() >= 100){ // reconstruction finished
-                solution_idx = i;
-                break;
-            }
-            if (paths[i].empty()) continue; // empty path - ignore
-
-			// Get the last and first vertex of the current path
-            int current_last_vertex = paths[i].back();
-            int current_first_vertex = paths[i].front();
-
-			// Initialize the nearest neighbors and their distances
-            double min_distance_last = std::numeric_limits<double>::max();
-            double min_distance_first = std::numeric_limits<double>::max();
-            int nearest_neighbor_last = -1;
-            int nearest_neighbor_first = -1;
-
-			// Iterate over all vertices to find the nearest neighbors for the last and first vertices
-            for (int j = 0; j < dist_matrix.x_coord.size(); ++j) {
-				//If the vertex not in the current path and not visited(free)
-                if (visited_map.find(j) != visited_map.end() && visited_map[j].first != i && visited_map[j].first != available(NOT)){
-
-						// Get the distance between the last vertex and the current vertex, if it is smaller than the current minimum distance
-                        double distance_last = dist_matrix.dist_matrix[current_last_vertex][j];
-						if (distance_last < min_distance_last) {
-                            min_distance_last = distance_last;
-                            nearest_neighbor_last = j;
-                    
-						// Get the distance between the first vertex and the current vertex, if it is smaller than the current minimum distance
-                        double distance_first = dist_matrix.dist_matrix[current_first_vertex][j];
-                        if (distance_first < min_distance_first) {
-                            min_distance_first = distance_first;
-                            nearest_neighbor_first = j;
-                        }
-                    }
-                }
-            }
-			// Choose the best vertex to add to the path
-            int best_vertex, which_side;
-			// If the distance from the last vertex is smaller than the distance from the first vertex, choose the last vertex and set the side to RIGHT
-            if (min_distance_last < min_distance_first){
-                best_vertex = nearest_neighbor_last;
-                which_side = side(RIGHT);
-            } else {
-				// Otherwise, choose the first vertex and set the side to LEFT
-                best_vertex = nearest_neighbor_first;
-                which_side = side(LEFT);
-            }
-            int j = best_vertex; // change the name for better readability
-
-            // Print the best vertex
-            std::cout << "Current left vertex: " << current_first_vertex << std::endl;
-            std::cout << "Current right vertex: " << current_last_vertex << std::endl;
-            std::cout << "Best Vertex: " << j << std::endl;
-            std::cout << "J Availability: (-2 = NOT | -1 = FREE | path_idx): " << visited_map[j].first << std::endl;
-            std::cout << "Which Side I (-1 = Left | 1 = Right): " << which_side << std::endl;
-            std::cout << "Which Side J (-1 = Left | 1 = Right): " << visited_map[j].second << std::endl;
-            std::cout << "PATH(I): " << i << std::endl;
-            std::cout << "PATH(J): " << visited_map[j].first << std::endl;
-            std::cout << std::endl;
-
+// Rebuilds two cycles from the edges a partial solution keeps (HEA: the
+// edges of the first parent that the second parent also has).
+//
+// The kept edges and then the candidate edges of the path endpoints,
+// shortest first, join the paths greedily as long as no path grows over
+// the larger cycle. The first cycle then starts from the longest path and
+// keeps taking the path whose endpoint is nearest to its last vertex,
+// cutting the final one to the exact size; the second cycle chains the
+// rest the same way. Everything but the rare endpoint lookups that miss
+// the candidate lists is near linear.
+template <typename MatrixT>
+auto TSP<MatrixT>::rebuild_from_fragments(
+	const std::vector<std::pair<int, int>> &edges)
+	-> std::tuple<std::vector<int>, std::vector<int>> {
+	const int n = dist_matrix.size();
+	const int sizes[2] = {n - n / 2, n / 2};
+	if (rebuild_candidates.empty()) {
+		rebuild_candidates = CandidateLists(dist_matrix, 8);
+	}
+	const int k = rebuild_candidates.neighbours();
 
-			//Print the current path
-			std::cout << "Current Path: ";	
-			for (int vertex : paths[i]){
-				std::cout << vertex << " ";
+	Fragments fragments(n);
+	auto try_join = [&](int u, int v) {
+		if (fragments.joinable(u, v) &&
+			fragments.size(u) + fragments.size(v) <= sizes[0]) {
+			fragments.join(u, v);
+		}
+	};
+	for (auto [u, v] : edges) {
+		try_join(u, v);
+	}
+	std::vector<std::tuple<int, int, int>> candidates; // length, u, v
+	for (int u = 0; u < n; ++u) {
+		if (!fragments.endpoint(u)) {
+			continue;
+		}
+		const int *list = rebuild_candidates.of(u);
+		for (int i = 0; i < k; ++i) {
+			if (u < list[i] && fragments.endpoint(list[i])) {
+				candidates.push_back({dist_matrix(u, list[i]), u, list[i]});
 			}
-			std::cout << std::endl;
-
-			// print the  paths[visited_map[j].first]
-			// std::cout << "Neighbour path: ";
-			// for (int vertex : paths[visited_map[j].first]){
-			// 	std::cout << vertex << " ";
-			// }
-			// std::cout << std::endl;
-
-			// If the vertex is isolated, add it to the path
-            if (visited_map[j].first == available(FREE)){ // isolated vertex
-                // auto [vertex, where] = find_neighbour(current_last_vertex, current_first_vertex, j);
-				std::cout << "FREE" << std::endl;
-
-				// If the vertex is on the right side, add it to the end of the path
-                if (which_side == side(RIGHT)){
-                    visited_map[current_last_vertex] = {available(NOT), 0};
-                    visited_map[j] = {i, side(RIGHT)};
-                    paths[i].push_back(j);
-
-				// Otherwise, add it to the beginning of the path and 
-                }else { // left
-					// Change current_first_vertex status to NOT available
-                    visited_map[current_first_vertex] = {available(NOT), 0};
-					// Change the status of the neighbour vertex to the path index and the side to LEFT
-                    visited_map[j] = {i, side(LEFT)};
-					// Add the vertex to the beginning of the path
-                    paths[i].insert(paths[i].begin(), j);
-                }
-
-			// If the vertex is already in a path
-            }else{
-
-				// If the vertex is on the right side
-                if (visited_map[j].second == side(RIGHT)){ // merge paths from the RIGHT; j from RIGHT
-					//visited_map[j] = {available(NOT), 0}; // change status of the vertex to NOT available
-
-                    // TODO j-ty z prawej strony:
-					if (which_side  == side(RIGHT)) { // Unusual case, because the vertex is on the right side 
-						std::cout << "i RIGHT j RIGHT " << std::endl;
-                        std::cout << "Neighbour path: ";
-                        for (int vertex : paths[visited_map[j].first]){
-                            std::cout << vertex << " ";
-                        }
-                        std::cout << std::endl;
-                        // j from RIGHT and i from RIGHT: paths[i] = merged(paths[i], std::reversed(paths[j]))
-						visited_map[current_last_vertex] = {available(NOT), 0}; // change status of the current_last_vertex to NOT available, because it will be merged with the path from the end
-
-
-						// Reverse the path and merge it with the current path
-                        std::reverse(paths[visited_map[j].first].begin(), paths[visited_map[j].first].end()); //????
-                        paths[i].insert(paths[i].begin(), paths[visited_map[j].first].begin(),
-                                        paths[visited_map[j].first].end());
-
-						// Update the visited_map
-                        visited_map[paths[i].back()] = {i, side(RIGHT)};
-						visited_map[j] = {available(NOT), 0}; // change status of the vertex to NOT available
-                        paths[visited_map[j].first].clear();
-                        //paths[visited_map[j].first] = std::vector<int>();
-
-                    } else { // left	// TODO: nigdy tego nie widzialem xd
-						std::cout << "i LEFT j RIGHT " << std::endl;
-                        std::cout << "Neighbour path: ";
-                        for (int vertex : paths[visited_map[j].first]){
-                            std::cout << vertex << " ";
-                        }
-                        std::cout << std::endl;
-                        // j from RIGHT i from LEFT: paths[i] = merged(paths[j], paths[i])
-                        visited_map[current_first_vertex] = {available(NOT), 0};
-
-                        //visited_map[visited_map[j].first] = {available(NOT), 0};// ???
-                        
-						std::vector<int> tmp = paths[i];
-                        std::cout << "TMP size: " << tmp.size() << std::endl;
-                        std::cout << "PATHS[i] size: " << paths[i].size() << std::endl;
-                        paths[i].clear();
-                        std::cout << "PATHS[i] size: " << paths[i].size() << std::endl;
-                        std::cout << "TMP size: " << tmp.size() << std::endl;
-                        //paths[i] = std::vector<int>();
-                        paths[i].insert(paths[i].end(), paths[visited_map[j].first].begin(), paths[visited_map[j].first].end());
-                        paths[i].insert(paths[i].end(), tmp.begin(), tmp.end());
-                        std::cout << "PATHS[i] size: " << paths[i].size() << std::endl;
-
-
-						visited_map[paths[i].front()] = {i, side(LEFT)};
-
-						visited_map[j] = {available(NOT), 0}; // change status of the vertex to NOT available
-                        paths[visited_map[j].first].clear();
-                        //paths[visited_map[j].first] = std::vector<int>();
-                    }
-                } else { // merge paths to the LEFT
-
-
-					// TODO j-ty z lewej strony:
-                    if (which_side == side(RIGHT)){
-						std::cout << "i RIGHT j LEFT " << std::endl;
-
-						// Print the  neighbour path
-						std::cout << "Neighbour path: ";
-						for (int vertex : paths[visited_map[j].first]){
-							std::cout << vertex << " ";
-						}
-						std::cout << std::endl;
-
-                        // j from LEFT i from RIGHT: paths[i] = merged(paths[i], paths[j])
-                        visited_map[current_last_vertex] = {available(NOT), 0};
-                        std::cout << "PATHS[i] size: " << paths[i].size() << std::endl;
-                        paths[i].insert(paths[i].end(), paths[visited_map[j].first].begin(), paths[visited_map[j].first].end());
-                        std::cout << "PATHS[i] size: " << paths[i].size() << std::endl;
-						visited_map[paths[i].back()] = {i, side(RIGHT)};
-
-						visited_map[j] = {available(NOT), 0};
-                        paths[visited_map[j].first].clear();
-                        // paths[visited_map[j].first] = std::vector<int>();
-						
-                    } else { // left
-						std::cout << "i LEFT j LEFT " << std::endl;
-                        std::cout << "Neighbour path: ";
-                        for (int vertex : paths[visited_map[j].first]){
-                            std::cout << vertex << " ";
-                        }
-                        std::cout << std::endl;
-                        // j from LEFT i from LEFT: paths[i] = merged(std::reversed(paths[j]), paths[i])
-                        visited_map[current_first_vertex] = {available(NOT), 0};
-                        //visited_map[visited_map[j].first] = {available(NOT), 0};
-
-                        std::reverse(paths[visited_map[j].first].begin(), paths[visited_map[j].first].end());
-                        std::vector<int> tmp = paths[i];
-                        paths[i].clear();
-                        // paths[i] = std::vector<int>();
-                        paths[i].insert(paths[i].begin(), paths[visited_map[j].first].begin(), paths[visited_map[j].first].end());
-                        paths[i].insert(paths[i].end(), tmp.begin(), tmp.end());
-
-                        visited_map[paths[i].front()] = {i, side(LEFT)};
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+	for (auto [length, u, v] : candidates) {
+		try_join(u, v);
+	}
 
-						visited_map[j] = {available(NOT), 0};
-                        paths[visited_map[j].first].clear();
-                        //paths[visited_map[j].first] = std::vector<int>();
-                    }
-                }
-            }
-			//Print the current path
-			std::cout << "New Path: ";
-			for (int vertex : paths[i]){
-				std::cout << vertex << " ";
+	// Paths by index; path_of maps both endpoints of a path not used yet.
+	std::vector<std::vector<int>> paths;
+	std::vector<int> path_of(n, -1);
+	std::vector<int> loose; // endpoints, pruned lazily
+	for (int u = 0; u < n; ++u) {
+		if (fragments.endpoint(u) && path_of[u] < 0) {
+			path_of[u] = path_of[fragments.other_end(u)] = paths.size();
+			paths.push_back(fragments.path(u));
+			loose.push_back(u);
+			if (fragments.other_end(u) != u) {
+				loose.push_back(fragments.other_end(u));
 			}
-			std::cout << std::endl;
-            std::cout << "Old neighbour path: ";
-            for (int vertex : paths[visited_map[j].first]){
-                std::cout << vertex << " ";
-            } std::cout<<std::endl;
-            calculate_current_size(paths);
-			std::cout << "----------------------------------------------" <<std::endl;
-
-        }
-    }
-
-    return paths[solution_idx];
+		}
+	}
+	auto take = [&](int p) {
+		path_of[paths[p].front()] = path_of[paths[p].back()] = -1;
+	};
+	// endpoint of an unused path nearest to u
+	auto nearest_end = [&](int u) {
+		const int *list = rebuild_candidates.of(u);
+		for (int i = 0; i < k; ++i) {
+			if (path_of[list[i]] >= 0) {
+				return list[i];
+			}
+		}
+		int best = -1;
+		auto last = std::remove_if(loose.begin(), loose.end(),
+								   [&](int v) { return path_of[v] < 0; });
+		loose.erase(last, loose.end());
+		for (int v : loose) {
+			if (best < 0 || dist_matrix(u, v) < dist_matrix(u, best)) {
+				best = v;
+			}
+		}
+		return best;
+	};
+
+	std::vector<int> cycles[2];
+	int longest = 0;
+	for (int p = 1; p < paths.size(); ++p) {
+		if (paths[p].size() > paths[longest].size()) {
+			longest = p;
+		}
+	}
+	int from = paths[longest].front(); // endpoint the next path starts at
+	for (int c = 0; c < 2; ++c) {
+		std::vector<int> &cycle = cycles[c];
+		while (cycle.size() < sizes[c]) {
+			if (from < 0) {
+				from = nearest_end(cycle.empty() ? cycles[0].back()
+												 : cycle.back());
+			}
+			const int p = path_of[from];
+			std::vector<int> &path = paths[p];
+			take(p);
+			if (path.front() != from) {
+				std::reverse(path.begin(), path.end());
+			}
+			const int room = sizes[c] - cycle.size();
+			if (path.size() > room) { // the rest starts the second cycle
+				cycle.insert(cycle.end(), path.begin(), path.begin() + room);
+				path.erase(path.begin(), path.begin() + room);
+				path_of[path.front()] = path_of[path.back()] = p;
+				loose.push_back(path.front());
+				loose.push_back(path.back());
+				from = path.front();
+				break;
+			}
+			cycle.insert(cycle.end(), path.begin(), path.end());
+			from = -1;
+		}
+	}
+	return {cycles[0], cycles[1]};
 }
 
-
+INSTANTIATE_TSP
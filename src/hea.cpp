@@ -1,6 +1,7 @@
 #include "../lib/tsp.h"
 
-auto TSP::hybrid_evolution_algo()
+template <typename MatrixT>
+auto TSP<MatrixT>::hybrid_evolution_algo()
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	// Initialization
 	// Generate an initial population of 20 solutions using local search
@@ -35,12 +36,15 @@ auto TSP::hybrid_evolution_algo()
         edges.insert(edges1.begin(), edges1.end());
         edges.insert(edges2.begin(), edges2.end());
 
-        std::map<int, std::pair<int, int>> visited_map1;
-        std::map<int, std::pair<int, int>> visited_map2;
-        auto c1 = remove_edges(parent1_cycle1, edges); // czy przy tej logice 2 roznie visited_map potrzebne
-        auto c2 = remove_edges(parent1_cycle2, edges);
-
-        auto cur_solution = find_greedy_cycles_regret_from_incomplete(c1, c2); 
+        std::tuple<std::vector<int>, std::vector<int>> cur_solution;
+        if (params.fragment_rebuild) {
+            cur_solution = rebuild_from_fragments(
+                common_edges(parent1_cycle1, parent1_cycle2, edges));
+        } else {
+            auto c1 = remove_edges(parent1_cycle1, edges);
+            auto c2 = remove_edges(parent1_cycle2, edges);
+            cur_solution = find_greedy_cycles_regret_from_incomplete(c1, c2);
+        }
 
         // Optional Local Search
          if (params.using_local_search == 1) {
@@ -71,7 +75,8 @@ auto TSP::hybrid_evolution_algo()
 }
 
 //Create function for finding the best and worst solution in the population
-auto TSP::find_best_worst_solution(std::vector<std::tuple<std::vector<int>, std::vector<int>>> population, bool find_best) -> std::pair<int, int> {
+template <typename MatrixT>
+auto TSP<MatrixT>::find_best_worst_solution(std::vector<std::tuple<std::vector<int>, std::vector<int>>> population, bool find_best) -> std::pair<int, int> {
     int best = 0;
     int worst = 0;
     int best_value = calculate_objective(std::get<0>(population[0]), std::get<1>(population[0]));
@@ -93,25 +98,25 @@ auto TSP::find_best_worst_solution(std::vector<std::tuple<std::vector<int>, std:
 
 
 // Select two different parent solutions uniformly at random.
-auto TSP::select_two_parents(
+template <typename MatrixT>
+auto TSP<MatrixT>::select_two_parents(
 	const std::vector<std::tuple<std::vector<int>, std::vector<int>>>
 		population) -> std::pair<int, int> {
-	std::random_device rd;
-	std::mt19937 gen(rd());
 	std::uniform_int_distribution<int> dist(0, population.size() - 1);
 
-	int parent1 = dist(gen);
-	int parent2 = dist(gen);
+	int parent1 = dist(rng);
+	int parent2 = dist(rng);
 	while (parent1 == parent2) {
-		parent2 = dist(gen);
+		parent2 = dist(rng);
 	}
 
 	return std::make_pair(parent1, parent2);
 }
 
 // Helper function to find edges in a cycle
+template <typename MatrixT>
 std::unordered_set<std::pair<int, int>, pair_hash>
-TSP::findEdges(const std::vector<int> &cycle) {
+TSP<MatrixT>::findEdges(const std::vector<int> &cycle) {
 	std::unordered_set<std::pair<int, int>, pair_hash> edges;
 	for (size_t i = 0; i < cycle.size(); ++i) {
 		int from = cycle[i];
@@ -124,10 +129,31 @@ TSP::findEdges(const std::vector<int> &cycle) {
 }
 
 
+// Edges of the two cycles that are also in other_edges, for
+// rebuild_from_fragments.
+template <typename MatrixT>
+auto TSP<MatrixT>::common_edges(const std::vector<int> &c1,
+								const std::vector<int> &c2,
+								const std::unordered_set<std::pair<int, int>, pair_hash> &other_edges)
+	-> std::vector<std::pair<int, int>> {
+	std::vector<std::pair<int, int>> common;
+	for (const std::vector<int> *cycle : {&c1, &c2}) {
+		for (size_t i = 0; i < cycle->size(); ++i) {
+			int from = (*cycle)[i];
+			int to = (*cycle)[(i + 1) % cycle->size()];
+			if (other_edges.count({std::min(from, to), std::max(from, to)})) {
+				common.push_back({from, to});
+			}
+		}
+	}
+	return common;
+}
+
 //1. Find edges that do not occur in the second parent
 //2. Remove them from the cycle, also remove the vertices that have no more edges from the cycle
 //3. Connect the remaining vertices, which occur in both parents, to each other
-auto TSP::remove_edges(std::vector<int>&  cycle, const std::unordered_set<std::pair<int, int>, pair_hash>& other_edges) -> std::vector<int>
+template <typename MatrixT>
+auto TSP<MatrixT>::remove_edges(std::vector<int>&  cycle, const std::unordered_set<std::pair<int, int>, pair_hash>& other_edges) -> std::vector<int>
 {
     std::vector<int> new_cycle;
     for (size_t i = 0; i < cycle.size(); ++i) {
@@ -149,3 +175,5 @@ auto TSP::remove_edges(std::vector<int>&  cycle, const std::unordered_set<std::p
 
     return new_cycle;
 }
+
+INSTANTIATE_TSP
@@ -0,0 +1,62 @@
+#include "../lib/indexed_heap.h"
+
+void IndexedHeap::set(int id, double key) {
+	keys[id] = key;
+	if (!contains(id)) {
+		position[id] = heap.size();
+		heap.push_back(id);
+	}
+	sift_up(position[id]);
+	sift_down(position[id]);
+}
+
+void IndexedHeap::erase(int id) {
+	const int p = position[id];
+	const int last = heap.back();
+	heap.pop_back();
+	position[id] = -1;
+	if (last == id) {
+		return;
+	}
+	place(last, p);
+	sift_up(p);
+	sift_down(position[last]);
+}
+
+void IndexedHeap::place(int id, int p) {
+	heap[p] = id;
+	position[id] = p;
+}
+
+void IndexedHeap::sift_up(int p) {
+	const int id = heap[p];
+	while (p > 0) {
+		int parent = (p - 1) / 2;
+		if (!before(id, heap[parent])) {
+			break;
+		}
+		place(heap[parent], p);
+		p = parent;
+	}
+	place(id, p);
+}
+
+void IndexedHeap::sift_down(int p) {
+	const int id = heap[p];
+	const int size = heap.size();
+	while (true) {
+		int child = 2 * p + 1;
+		if (child >= size) {
+			break;
+		}
+		if (child + 1 < size && before(heap[child + 1], heap[child])) {
+			++child;
+		}
+		if (!before(heap[child], id)) {
+			break;
+		}
+		place(heap[child], p);
+		p = child;
+	}
+	place(id, p);
+}
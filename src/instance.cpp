@@ -0,0 +1,280 @@
+#include "../lib/instance.h"
+#include "../lib/cache.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+// Cursor over the memory-mapped .tsp file. Everything is parsed in place
+// from the mapping, without copying lines into strings.
+struct Reader {
+	const char *pos;
+	const char *end;
+
+	bool done() const { return pos >= end; }
+
+	void skip_whitespace() {
+		while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' ||
+							 *pos == '\n')) {
+			++pos;
+		}
+	}
+
+	std::string_view line() {
+		const char *start = pos;
+		while (pos < end && *pos != '\n') {
+			++pos;
+		}
+		std::string_view result(start, pos - start);
+		if (pos < end) {
+			++pos;
+		}
+		return trim(result);
+	}
+
+	// Parses the next number; leaves the cursor untouched when the next token
+	// is not a number (e.g. the keyword that ends a section).
+	template <typename Number> bool number(Number &value) {
+		skip_whitespace();
+		const char *start = pos;
+		if (start < end && *start == '+') {
+			++start;
+		}
+		auto [next, ec] = std::from_chars(start, end, value);
+		if (ec != std::errc()) {
+			return false;
+		}
+		pos = next;
+		return true;
+	}
+
+	static std::string_view trim(std::string_view s) {
+		while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+			s.remove_prefix(1);
+		}
+		while (!s.empty() &&
+			   (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+			s.remove_suffix(1);
+		}
+		return s;
+	}
+};
+
+// TSPLIB GEO coordinates are DDD.MM (degrees and minutes); converts one to
+// radians with the constants the TSPLIB documentation prescribes.
+double geo_radians(double value) {
+	const double pi = 3.141592;
+	int degrees = static_cast<int>(value);
+	double minutes = value - degrees;
+	return pi * (degrees + 5.0 * minutes / 3.0) / 180.0;
+}
+
+// Expands an EDGE_WEIGHT_SECTION given in `format` into a full n x n matrix.
+bool expand_weights(std::string_view format, const std::vector<int> &values,
+					int n, std::vector<int> &weights) {
+	weights.assign(static_cast<std::size_t>(n) * n, 0);
+	auto at = [&](int i, int j) -> int & {
+		return weights[static_cast<std::size_t>(i) * n + j];
+	};
+	std::size_t k = 0;
+	bool missing = false;
+	auto next = [&](int i, int j) {
+		if (k < values.size()) {
+			at(i, j) = at(j, i) = values[k++];
+		} else {
+			missing = true;
+		}
+	};
+
+	if (format == "FULL_MATRIX") {
+		if (values.size() < weights.size()) {
+			return false;
+		}
+		std::copy(values.begin(), values.begin() + weights.size(),
+				  weights.begin());
+		return true;
+	}
+	// A column-wise upper triangle lists the same entries as the row-wise
+	// lower one (and vice versa), since the matrix is symmetric.
+	bool upper, diagonal;
+	if (format == "UPPER_ROW" || format == "LOWER_COL") {
+		upper = true, diagonal = false;
+	} else if (format == "LOWER_ROW" || format == "UPPER_COL") {
+		upper = false, diagonal = false;
+	} else if (format == "UPPER_DIAG_ROW" || format == "LOWER_DIAG_COL") {
+		upper = true, diagonal = true;
+	} else if (format == "LOWER_DIAG_ROW" || format == "UPPER_DIAG_COL") {
+		upper = false, diagonal = true;
+	} else {
+		std::cerr << "Unsupported EDGE_WEIGHT_FORMAT: " << format << std::endl;
+		return false;
+	}
+	for (int i = 0; i < n; i++) {
+		int from = upper ? (diagonal ? i : i + 1) : 0;
+		int to = upper ? n : (diagonal ? i + 1 : i);
+		for (int j = from; j < to; j++) {
+			next(i, j);
+		}
+	}
+	return !missing;
+}
+
+} // namespace
+
+// Reads a TSPLIB file: DIMENSION, EDGE_WEIGHT_TYPE (EUC_2D, CEIL_2D, ATT, GEO,
+// EXPLICIT) and EDGE_WEIGHT_FORMAT from the header, then NODE_COORD_SECTION
+// or EDGE_WEIGHT_SECTION. The file is mapped once and numbers are read with
+// std::from_chars, so coordinates keep their fractional part.
+bool Instance::load_from_path(const std::string &path) {
+	auto file = MappedFile::open(path);
+	if (!file) {
+		std::cerr << "Error opening file." << std::endl;
+		return false;
+	}
+	Reader in{file->data(), file->data() + file->size()};
+	std::string_view weight_format = "FULL_MATRIX";
+	std::vector<int> values;
+	dimension = 0;
+	weight_type = EdgeWeightType::euc_2d;
+	x_coord.clear();
+	y_coord.clear();
+	weights.clear();
+
+	while (!in.done()) {
+		std::string_view line = in.line();
+		if (line.empty()) {
+			continue;
+		}
+		std::size_t colon = line.find(':');
+		std::string_view key = Reader::trim(line.substr(0, colon));
+		std::string_view value =
+			colon == std::string_view::npos
+				? std::string_view()
+				: Reader::trim(line.substr(colon + 1));
+
+		if (key == "EOF") {
+			break;
+		} else if (key == "DIMENSION") {
+			std::from_chars(value.data(), value.data() + value.size(),
+							dimension);
+			x_coord.reserve(dimension);
+			y_coord.reserve(dimension);
+		} else if (key == "EDGE_WEIGHT_TYPE") {
+			if (value == "EUC_2D") {
+				weight_type = EdgeWeightType::euc_2d;
+			} else if (value == "CEIL_2D") {
+				weight_type = EdgeWeightType::ceil_2d;
+			} else if (value == "ATT") {
+				weight_type = EdgeWeightType::att;
+			} else if (value == "GEO") {
+				weight_type = EdgeWeightType::geo;
+			} else if (value == "EXPLICIT") {
+				weight_type = EdgeWeightType::explicit_weights;
+			} else {
+				std::cerr << "Unsupported EDGE_WEIGHT_TYPE: " << value
+						  << std::endl;
+				return false;
+			}
+		} else if (key == "EDGE_WEIGHT_FORMAT") {
+			weight_format = value;
+		} else if (key == "NODE_COORD_SECTION") {
+			double id, x, y;
+			while (in.number(id) && in.number(x) && in.number(y)) {
+				x_coord.push_back(x);
+				y_coord.push_back(y);
+			}
+		} else if (key == "EDGE_WEIGHT_SECTION") {
+			values.reserve(static_cast<std::size_t>(dimension) * dimension);
+			int w;
+			while (in.number(w)) {
+				values.push_back(w);
+			}
+		} else if (key.size() > 8 &&
+				   key.substr(key.size() - 8) == "_SECTION") {
+			double skipped; // e.g. DISPLAY_DATA_SECTION
+			while (in.number(skipped)) {
+			}
+		}
+	}
+
+	if (weight_type == EdgeWeightType::explicit_weights) {
+		if (dimension <= 0 ||
+			!expand_weights(weight_format, values, dimension, weights)) {
+			std::cerr << "Invalid EDGE_WEIGHT_SECTION in " << path
+					  << std::endl;
+			return false;
+		}
+		x_coord.clear();
+		y_coord.clear();
+		return true;
+	}
+	if (dimension == 0) {
+		dimension = x_coord.size();
+	}
+	if (x_coord.size() != static_cast<std::size_t>(dimension)) {
+		std::cerr << "Expected " << dimension << " nodes in " << path
+				  << ", found " << x_coord.size() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int Instance::calc_distance(int i, int j) const {
+	if (weight_type == EdgeWeightType::explicit_weights) {
+		return weights[static_cast<std::size_t>(i) * dimension + j];
+	}
+	if (weight_type == EdgeWeightType::geo) {
+		const double radius = 6378.388;
+		double lat_i = geo_radians(x_coord[i]), lon_i = geo_radians(y_coord[i]);
+		double lat_j = geo_radians(x_coord[j]), lon_j = geo_radians(y_coord[j]);
+		double q1 = std::cos(lon_i - lon_j);
+		double q2 = std::cos(lat_i - lat_j);
+		double q3 = std::cos(lat_i + lat_j);
+		return static_cast<int>(
+			radius * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) +
+			1.0);
+	}
+
+	double dx = x_coord[i] - x_coord[j];
+	double dy = y_coord[i] - y_coord[j];
+	if (weight_type == EdgeWeightType::ceil_2d) {
+		return static_cast<int>(std::ceil(std::sqrt(dx * dx + dy * dy)));
+	}
+	if (weight_type == EdgeWeightType::att) {
+		double r = std::sqrt((dx * dx + dy * dy) / 10.0);
+		int t = static_cast<int>(r + 0.5);
+		return t < r ? t + 1 : t;
+	}
+	return static_cast<int>(std::sqrt(dx * dx + dy * dy) + 0.5);
+}
+
+// Lower and upper bound on the pairwise distances, used to pick the matrix
+// element type. EXPLICIT weights may be negative; the coordinate metrics
+// start at 0 and end below the diagonal of the bounding box.
+std::pair<int, int> Instance::distance_range() const {
+	if (weight_type == EdgeWeightType::explicit_weights) {
+		if (weights.empty()) {
+			return {0, 0};
+		}
+		auto [min, max] = std::minmax_element(weights.begin(), weights.end());
+		return {*min, *max};
+	}
+	if (weight_type == EdgeWeightType::geo) {
+		return {0, static_cast<int>(6378.388 * 3.141592) + 1};
+	}
+	if (x_coord.empty()) {
+		return {0, 0};
+	}
+	auto [min_x, max_x] = std::minmax_element(x_coord.begin(), x_coord.end());
+	auto [min_y, max_y] = std::minmax_element(y_coord.begin(), y_coord.end());
+	double dx = *max_x - *min_x;
+	double dy = *max_y - *min_y;
+	double diagonal = std::sqrt(dx * dx + dy * dy);
+	if (weight_type == EdgeWeightType::att) {
+		diagonal /= std::sqrt(10.0);
+	}
+	return {0, static_cast<int>(std::ceil(diagonal)) + 1};
+}
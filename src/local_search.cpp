@@ -1,117 +1,271 @@
+#include <numeric>
 #include <utility>
 
 #include "../lib/tsp.h"
 
-auto TSP::generate_all_edge_movements(int n) -> std::vector<std::vector<int>> {
-	// idx:2 inner move : type = 0
-	// idx:2 inter movement: type = 1
-	// idx:3 edge = 0, vertex = 1
-	// idx:4 cycle1 = 0, cycle2 = 1
-	std::vector<std::vector<int>> movements; // i, j, type
+// Distance sources whose rows can be read directly by the batch kernels.
+template <typename MatrixT> struct full_rows : std::false_type {};
+template <typename T>
+struct full_rows<Matrix<T, DistMatrix>> : std::true_type {};
+
+#ifdef __AVX2__
+// d(v, idx[k]) for 8 indices at once from one matrix row. 16-bit elements
+// are gathered as 32-bit words and masked, which reads 2 bytes past the
+// requested element - callers must not use it on the last row.
+template <typename T> inline __m256i gather_row(const T *row, __m256i idx) {
+	if constexpr (sizeof(T) == sizeof(uint16_t)) {
+		return _mm256_and_si256(
+			_mm256_i32gather_epi32(reinterpret_cast<const int *>(row), idx, 2),
+			_mm256_set1_epi32(0xffff));
+	} else {
+		return _mm256_i32gather_epi32(reinterpret_cast<const int *>(row), idx,
+									  4);
+	}
+}
+#endif
+
+// Inner move generators take the sizes of both cycles, which differ by one
+// for an odd number of vertices.
+template <typename MatrixT>
+auto TSP<MatrixT>::generate_all_edge_movements(int n1, int n2)
+	-> std::vector<Movement> {
+	const int sizes[2] = {n1, n2};
+	const int n = std::max(n1, n2);
+	std::vector<Movement> movements;
+	movements.reserve(n * (n - 3));
 	for (int i = 0; i < n; ++i) {
 		for (int j = i + 2; j < n; ++j) {
-			if (i == 0 && j == n - 1)
-				continue;
 			for (int k = 0; k < 2; ++k) {
-				movements.push_back({i, j, 0, 0, k});
+				if (j >= sizes[k] || (i == 0 && j == sizes[k] - 1))
+					continue;
+				movements.push_back({i, j, 0, 0, int8_t(k)});
 			}
 		}
 	}
 	return movements;
 }
 
-auto TSP::generate_all_vertex_movements(int n)
-	-> std::vector<std::vector<int>> {
-	// inner move : type = 0
-	// inter movement: type = 1
-	std::vector<std::vector<int>> movements; // i, j, type
+template <typename MatrixT>
+auto TSP<MatrixT>::generate_all_vertex_movements(int n1, int n2)
+	-> std::vector<Movement> {
+	const int sizes[2] = {n1, n2};
+	const int n = std::max(n1, n2);
+	std::vector<Movement> movements;
+	movements.reserve(n * (n - 1));
 	for (int i = 0; i < n; ++i) {
 		for (int j = i + 1; j < n; ++j) {
-			if (i == 0 && j == n - 1)
-				continue; // redundant - edge move (1, n-2) is the same as
-						  // vertex move (0, n-1)
 			for (int k = 0; k < 2; ++k) {
-				movements.push_back({i, j, 0, 0, k});
+				if (j >= sizes[k])
+					continue;
+				movements.push_back({i, j, 0, 1, int8_t(k)});
 			}
 		}
 	}
 	return movements;
 }
 
-auto TSP::generate_all_vertex_movements_inter(int n)
-	-> std::vector<std::vector<int>> {
-	// inner move : type = 0
-	// inter movement: type = 1
-	std::vector<std::vector<int>> movements;
-	for (int i = 0; i < n; ++i) {
-		for (int j = 0; j < n; ++j) {
-			if (i != j)
-				movements.push_back({i, j, 1, 1});
+template <typename MatrixT>
+auto TSP<MatrixT>::generate_all_vertex_movements_inter(int n1, int n2)
+	-> std::vector<Movement> {
+	std::vector<Movement> movements;
+	movements.reserve(n1 * n2);
+	for (int i = 0; i < n1; ++i) {
+		for (int j = 0; j < n2; ++j) {
+			movements.push_back({i, j, 1, 1, -1});
 		}
 	}
 	return movements;
 }
 
-auto TSP::get_delta(std::vector<int> movement) -> std::tuple<int, int> {
-	int i = movement[0];
-	int j = movement[1];
-	int n = cycle1.size();
+// Delta kernels: length of the removed edges minus length of the added ones,
+// so a positive value is an improvement.
+template <typename MatrixT>
+template <bool Vertex>
+int TSP<MatrixT>::inner_delta(int i, int j,
+							  const std::vector<int> &cycle) const {
+	int n = cycle.size();
 	int i_left = (i - 1 + n) % n;
 	int i_right = (i + 1) % n;
 	int j_left = (j - 1 + n) % n;
 	int j_right = (j + 1) % n;
-	float deleted, added;
-	int cycle_chosen = -1; // -1 none; 0 cycle1; 1 cycle2
-
-	if (movement[2] == 0) { // inner move
-		cycle_chosen = movement[4];
-		std::vector<int> &cycle =
-			(cycle_chosen == 0) ? cycle1 : cycle2; // TODO: potential issue
-		if (movement[3] == 0) {					   // edge
-			deleted = dist_matrix.dist_matrix[cycle[i]][cycle[i_left]] +
-					  dist_matrix.dist_matrix[cycle[j]][cycle[j_right]];
-			added = dist_matrix.dist_matrix[cycle[i]][cycle[j_right]] +
-					dist_matrix.dist_matrix[cycle[i_left]][cycle[j]];
-		} else {						// vertex
-			if (i == 0 && j == n - 1) { // extreme case
-				deleted = dist_matrix.dist_matrix[cycle[i]][cycle[i_right]] +
-						  dist_matrix.dist_matrix[cycle[j]][cycle[j_left]];
-				added = dist_matrix.dist_matrix[cycle[i]][cycle[j_left]] +
-						dist_matrix.dist_matrix[cycle[j]][cycle[i_right]];
-			} else if (j - i == 1) {
-				deleted = dist_matrix.dist_matrix[cycle[i]][cycle[i_left]] +
-						  dist_matrix.dist_matrix[cycle[j]][cycle[j_right]];
-				added = dist_matrix.dist_matrix[cycle[i]][cycle[j_right]] +
-						dist_matrix.dist_matrix[cycle[i_left]][cycle[j]];
-			} else {
-				deleted = dist_matrix.dist_matrix[cycle[i]][cycle[i_left]] +
-						  dist_matrix.dist_matrix[cycle[i]][cycle[i_right]] +
-						  dist_matrix.dist_matrix[cycle[j]][cycle[j_left]] +
-						  dist_matrix.dist_matrix[cycle[j]][cycle[j_right]];
-				added = dist_matrix.dist_matrix[cycle[i]][cycle[j_left]] +
-						dist_matrix.dist_matrix[cycle[i]][cycle[j_right]] +
-						dist_matrix.dist_matrix[cycle[j]][cycle[i_left]] +
-						dist_matrix.dist_matrix[cycle[j]][cycle[i_right]];
-			}
-		}
-	} else { // inter move
-		deleted = dist_matrix.dist_matrix[cycle1[i]][cycle1[i_left]] +
-				  dist_matrix.dist_matrix[cycle1[i]][cycle1[i_right]] +
-				  dist_matrix.dist_matrix[cycle2[j]][cycle2[j_left]] +
-				  dist_matrix.dist_matrix[cycle2[j]][cycle2[j_right]];
-		added = dist_matrix.dist_matrix[cycle1[i]][cycle2[j_left]] +
-				dist_matrix.dist_matrix[cycle1[i]][cycle2[j_right]] +
-				dist_matrix.dist_matrix[cycle2[j]][cycle1[i_left]] +
-				dist_matrix.dist_matrix[cycle2[j]][cycle1[i_right]];
-	}
-	return {(int)(deleted - added), cycle_chosen};
-}
-
-void TSP::update_cycle(const std::vector<int> &movement,
-					   std::vector<int> &cycle) {
-	int i = movement[0];
-	int j = movement[1];
-	int type = movement[3];
+	int deleted, added;
+	if constexpr (!Vertex) {
+		deleted = dist_matrix(cycle[i], cycle[i_left]) +
+				  dist_matrix(cycle[j], cycle[j_right]);
+		added = dist_matrix(cycle[i], cycle[j_right]) +
+				dist_matrix(cycle[i_left], cycle[j]);
+	} else if (i == 0 && j == n - 1) { // extreme case
+		deleted = dist_matrix(cycle[i], cycle[i_right]) +
+				  dist_matrix(cycle[j], cycle[j_left]);
+		added = dist_matrix(cycle[i], cycle[j_left]) +
+				dist_matrix(cycle[j], cycle[i_right]);
+	} else if (j - i == 1) {
+		deleted = dist_matrix(cycle[i], cycle[i_left]) +
+				  dist_matrix(cycle[j], cycle[j_right]);
+		added = dist_matrix(cycle[i], cycle[j_right]) +
+				dist_matrix(cycle[i_left], cycle[j]);
+	} else {
+		deleted = dist_matrix(cycle[i], cycle[i_left]) +
+				  dist_matrix(cycle[i], cycle[i_right]) +
+				  dist_matrix(cycle[j], cycle[j_left]) +
+				  dist_matrix(cycle[j], cycle[j_right]);
+		added = dist_matrix(cycle[i], cycle[j_left]) +
+				dist_matrix(cycle[i], cycle[j_right]) +
+				dist_matrix(cycle[j], cycle[i_left]) +
+				dist_matrix(cycle[j], cycle[i_right]);
+	}
+	return deleted - added;
+}
+
+template <typename MatrixT>
+int TSP<MatrixT>::inter_delta(int i, int j) const {
+	int n1 = cycle1.size(), n2 = cycle2.size();
+	int i_left = cycle1[(i - 1 + n1) % n1], i_right = cycle1[(i + 1) % n1];
+	int j_left = cycle2[(j - 1 + n2) % n2], j_right = cycle2[(j + 1) % n2];
+	int deleted = dist_matrix(cycle1[i], i_left) +
+				  dist_matrix(cycle1[i], i_right) +
+				  dist_matrix(cycle2[j], j_left) +
+				  dist_matrix(cycle2[j], j_right);
+	int added = dist_matrix(cycle1[i], j_left) +
+				dist_matrix(cycle1[i], j_right) +
+				dist_matrix(cycle2[j], i_left) +
+				dist_matrix(cycle2[j], i_right);
+	return deleted - added;
+}
+
+// Lays out the cycle2 side of the swap neighbourhood for best_inter_swap:
+// neighbours of every position and their distances to it.
+template <typename MatrixT> void TSP<MatrixT>::prepare_inter_swaps() {
+	const int n2 = cycle2.size();
+	swap_left.resize(n2);
+	swap_right.resize(n2);
+	swap_base.resize(n2);
+	for (int j = 0; j < n2; ++j) {
+		swap_left[j] = cycle2[(j - 1 + n2) % n2];
+		swap_right[j] = cycle2[(j + 1) % n2];
+		swap_base[j] = dist_matrix(cycle2[j], swap_left[j]) +
+					   dist_matrix(cycle2[j], swap_right[j]);
+	}
+}
+
+// Steepest scan over the swaps of cycle1[first..last) with every vertex of
+// cycle2. The delta of cycle1[i] against cycle2[j] is
+//   base1[i] + base2[j] - d(a, b_left) - d(a, b_right) - d(b, a_left) -
+//   d(b, a_right),
+// which the AVX2 path evaluates for 8 consecutive j at once from gathered
+// matrix rows, keeping the best delta per lane. Updates best_delta and
+// best_movement when a better swap is found; prepare_inter_swaps has to be
+// called after every change of the cycles.
+template <typename MatrixT>
+void TSP<MatrixT>::best_inter_swap(int &best_delta, Movement &best_movement,
+								   int first, int last) const {
+	const int n1 = cycle1.size(), n2 = cycle2.size();
+	const std::vector<int> &left = swap_left, &right = swap_right,
+						   &base2 = swap_base;
+
+#ifdef __AVX2__
+	const int initial_delta = best_delta;
+	__m256i best_lanes = _mm256_set1_epi32(best_delta);
+	__m256i best_i = _mm256_setzero_si256();
+	__m256i best_j = _mm256_setzero_si256();
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+#endif
+	for (int i = first; i < last; ++i) {
+		const int a = cycle1[i];
+		const int a_left = cycle1[(i - 1 + n1) % n1];
+		const int a_right = cycle1[(i + 1) % n1];
+		const int base1 = dist_matrix(a, a_left) + dist_matrix(a, a_right);
+		int j = 0;
+#ifdef __AVX2__
+		if constexpr (full_rows<MatrixT>::value) {
+			using T = typename MatrixT::value_type;
+			const int last = dist_matrix.size() - 1;
+			if (sizeof(T) != sizeof(uint16_t) ||
+				(a != last && a_left != last && a_right != last)) {
+				const T *row_a = dist_matrix.dist_matrix.row(a);
+				const T *row_left = dist_matrix.dist_matrix.row(a_left);
+				const T *row_right = dist_matrix.dist_matrix.row(a_right);
+				const __m256i base = _mm256_set1_epi32(base1);
+				const __m256i index = _mm256_set1_epi32(i);
+				for (; j + 8 <= n2; j += 8) {
+					auto load = [j](const std::vector<int> &v) {
+						return _mm256_loadu_si256(
+							reinterpret_cast<const __m256i *>(v.data() + j));
+					};
+					__m256i b = load(cycle2);
+					__m256i delta = _mm256_add_epi32(base, load(base2));
+					delta = _mm256_sub_epi32(delta,
+											 gather_row(row_a, load(left)));
+					delta = _mm256_sub_epi32(delta,
+											 gather_row(row_a, load(right)));
+					delta = _mm256_sub_epi32(delta, gather_row(row_left, b));
+					delta = _mm256_sub_epi32(delta, gather_row(row_right, b));
+					__m256i better = _mm256_cmpgt_epi32(delta, best_lanes);
+					best_lanes = _mm256_max_epi32(delta, best_lanes);
+					best_i = _mm256_blendv_epi8(best_i, index, better);
+					best_j = _mm256_blendv_epi8(
+						best_j, _mm256_add_epi32(_mm256_set1_epi32(j), lanes),
+						better);
+				}
+			}
+		}
+#endif
+		for (; j < n2; ++j) {
+			const int b = cycle2[j];
+			int delta = base1 + base2[j] - dist_matrix(a, left[j]) -
+						dist_matrix(a, right[j]) - dist_matrix(b, a_left) -
+						dist_matrix(b, a_right);
+			if (delta > best_delta) {
+				best_delta = delta;
+				best_movement = {i, j, 1, 1, -1};
+			}
+		}
+	}
+
+#ifdef __AVX2__
+	alignas(32) int deltas[8], is[8], js[8];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(deltas), best_lanes);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(is), best_i);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(js), best_j);
+	// Each lane holds its first best swap in row-major order; ties between
+	// lanes and the scalar result go to the smallest (i, j), so the result
+	// matches a plain row-major scan.
+	for (int lane = 0; lane < 8; ++lane) {
+		if (deltas[lane] <= initial_delta)
+			continue;
+		if (deltas[lane] > best_delta ||
+			(deltas[lane] == best_delta &&
+			 std::pair{is[lane], js[lane]} <
+				 std::pair{best_movement.i, best_movement.j})) {
+			best_delta = deltas[lane];
+			best_movement = {is[lane], js[lane], 1, 1, -1};
+		}
+	}
+#endif
+}
+
+// Returns the delta and the cycle an inner move applies to (-1 for inter
+// moves); used where moves of different kinds are mixed.
+template <typename MatrixT>
+auto TSP<MatrixT>::get_delta(Movement movement) -> std::tuple<int, int> {
+	if (movement.type >= 2) {
+		return {segment_delta(movement), movement.cycle};
+	}
+	if (movement.type != 0) {
+		return {inter_delta(movement.i, movement.j), -1};
+	}
+	const std::vector<int> &cycle = movement.cycle == 0 ? cycle1 : cycle2;
+	int delta = movement.vertex
+					? inner_delta<true>(movement.i, movement.j, cycle)
+					: inner_delta<false>(movement.i, movement.j, cycle);
+	return {delta, movement.cycle};
+}
+
+template <typename MatrixT>
+void TSP<MatrixT>::update_cycle(Movement movement, std::vector<int> &cycle) {
+	int i = movement.i;
+	int j = movement.j;
+	int type = movement.vertex;
 	if (type == 0) { // edge
 		std::reverse(cycle.begin() + i, cycle.begin() + j + 1);
 	} else { // vertex
@@ -119,8 +273,11 @@ void TSP::update_cycle(const std::vector<int> &movement,
 	}
 }
 
-void TSP::apply_movement(const std::vector<int> &movement, int cycle_num) {
-	if (cycle_num == 0) {
+template <typename MatrixT>
+void TSP<MatrixT>::apply_movement(Movement movement, int cycle_num) {
+	if (movement.type >= 2) {
+		apply_segment(movement);
+	} else if (cycle_num == 0) {
 		update_cycle(movement, cycle1);
 	} else if (cycle_num == 1) {
 		update_cycle(movement, cycle2);
@@ -129,80 +286,686 @@ void TSP::apply_movement(const std::vector<int> &movement, int cycle_num) {
 	}
 }
 
-void TSP::update_cycles(std::vector<int> movement) {
-	int i = movement[0]; // idx of vertex in cycle1
-	int j = movement[1]; // idx of vertex in cycle2
+template <typename MatrixT>
+void TSP<MatrixT>::update_cycles(Movement movement) {
+	int i = movement.i; // idx of vertex in cycle1
+	int j = movement.j; // idx of vertex in cycle2
 	int temp = cycle1[i];
 	cycle1[i] = cycle2[j];
 	cycle2[j] = temp;
 }
 
-void TSP::main_search(bool steepest, bool vertex) {
-	std::vector<std::vector<int>> movements;
-	std::vector<std::vector<int>> movements_inner;
-	std::vector<std::vector<int>> movements_inter =
-		generate_all_vertex_movements_inter(cycle1.size());
-	if (vertex) {
-		movements_inner = generate_all_vertex_movements(cycle1.size());
+template <typename MatrixT>
+void TSP<MatrixT>::main_search(bool steepest, bool vertex) {
+	if (params.move_list) {
+		list_search();
+		return;
+	}
+	if (!steepest && params.dont_look) {
+		vertex ? dont_look_search<true>() : dont_look_search<false>();
+		return;
+	}
+	if (params.candidates > 0) {
+		candidate_search(steepest);
+		return;
+	}
+
+	if (steepest && params.delta_cache) {
+		vertex ? cached_search<true>() : cached_search<false>();
+	} else if (steepest) {
+		vertex ? search<true, true>() : search<true, false>();
 	} else {
-		movements_inner = generate_all_edge_movements(cycle1.size());
+		vertex ? search<false, true>() : search<false, false>();
+	}
+}
+
+// Best move of the whole neighbourhood. The moves are cut into fixed-size
+// tasks - blocks of inner moves, blocks of segment moves, then blocks of
+// cycle1 positions for the swaps - each keeping its own best move, and the
+// results are reduced in task order. With params.threads > 1 the tasks run
+// on the thread pool; the chosen move is the same for any number of
+// threads.
+template <typename MatrixT>
+template <bool Vertex>
+void TSP<MatrixT>::steepest_scan(
+	const std::vector<Movement> &movements_inner,
+	const std::vector<Movement> &movements_segment, int &best_delta,
+	Movement &best_movement) {
+	constexpr int inner_block = 4096;
+	constexpr int inter_block = 16;
+	const int inner_tasks =
+		(movements_inner.size() + inner_block - 1) / inner_block;
+	const int segment_tasks =
+		(movements_segment.size() + inner_block - 1) / inner_block;
+	const int inter_tasks = (cycle1.size() + inter_block - 1) / inter_block;
+	std::vector<std::pair<int, Movement>> results(
+		inner_tasks + segment_tasks + inter_tasks, {best_delta, best_movement});
+	prepare_inter_swaps();
+
+	auto best_of = [&](const std::vector<Movement> &movements, int block,
+					   int &delta, Movement &movement, auto delta_of) {
+		int last = std::min<int>((block + 1) * inner_block, movements.size());
+		for (int m = block * inner_block; m < last; ++m) {
+			int value = delta_of(movements[m]);
+			if (value > delta) {
+				delta = value;
+				movement = movements[m];
+			}
+		}
+	};
+	auto task = [&](int t) {
+		auto &[delta, movement] = results[t];
+		if (t < inner_tasks) {
+			best_of(movements_inner, t, delta, movement, [&](Movement m) {
+				return inner_delta<Vertex>(m.i, m.j,
+										   m.cycle == 0 ? cycle1 : cycle2);
+			});
+		} else if (t < inner_tasks + segment_tasks) {
+			best_of(movements_segment, t - inner_tasks, delta, movement,
+					[&](Movement m) { return segment_delta(m); });
+		} else {
+			int first = (t - inner_tasks - segment_tasks) * inter_block;
+			best_inter_swap(delta, movement, first,
+							std::min<int>(first + inter_block, cycle1.size()));
+		}
+	};
+	run_tasks(results.size(), task);
+
+	for (const auto &[delta, movement] : results) {
+		if (delta > best_delta) {
+			best_delta = delta;
+			best_movement = movement;
+		}
 	}
-	movements.insert(movements.end(), movements_inter.begin(),
-					 movements_inter.end());
-	movements.insert(movements.end(), movements_inner.begin(),
-					 movements_inner.end());
+}
 
-	std::vector<int> best_movement;
-	bool found_better;
-	int objective_value, best_objective_value;
-	int cycle_num, best_cycle_num;
+// Steepest search reusing deltas between iterations (params.delta_cache).
+// The delta of a move depends only on the vertices at its positions and
+// their neighbours, so after a move only the moves next to a position whose
+// vertex changed are evaluated again; all other deltas come from the cache.
+// Moves are visited in the order of steepest_scan with the same
+// tie-breaking, so the search applies the same moves. Segment moves shift
+// many positions at once and are always evaluated.
+template <typename MatrixT>
+template <bool Vertex>
+void TSP<MatrixT>::cached_search() {
+	const std::vector<Movement> movements_inner =
+		Vertex ? generate_all_vertex_movements(cycle1.size(), cycle2.size())
+			   : generate_all_edge_movements(cycle1.size(), cycle2.size());
+	std::vector<Movement> movements_segment;
+	if (params.or_opt || params.cross_exchange > 1) {
+		movements_segment = generate_all_segment_movements(
+			cycle1.size(), cycle2.size(), params.or_opt,
+			params.cross_exchange);
+	}
+	const int n1 = cycle1.size(), n2 = cycle2.size();
+	std::vector<int> inner_cache(movements_inner.size());
+	std::vector<int> inter_cache(static_cast<std::size_t>(n1) * n2);
+
+	// dirty: vertex at the position changed, near: a position within one of
+	// a dirty one
+	std::vector<char> dirty[2] = {std::vector<char>(n1, 1),
+								  std::vector<char>(n2, 1)};
+	std::vector<char> near[2] = {std::vector<char>(n1),
+								 std::vector<char>(n2)};
+	auto mark = [&](int c, int first, int length) {
+		const int size = dirty[c].size();
+		for (int k = 0; k < length; ++k) {
+			dirty[c][(first + k) % size] = 1;
+		}
+	};
+
+	while (true) {
+		for (int c = 0; c < 2; ++c) {
+			const int size = dirty[c].size();
+			for (int p = 0; p < size; ++p) {
+				near[c][p] = dirty[c][(p - 1 + size) % size] | dirty[c][p] |
+							 dirty[c][(p + 1) % size];
+			}
+		}
+
+		int best_delta = 0;
+		Movement best_movement;
+		for (int m = 0; m < movements_inner.size(); ++m) {
+			const Movement movement = movements_inner[m];
+			const std::vector<char> &near_cycle = near[movement.cycle];
+			if (near_cycle[movement.i] || near_cycle[movement.j]) {
+				inner_cache[m] = inner_delta<Vertex>(
+					movement.i, movement.j,
+					movement.cycle == 0 ? cycle1 : cycle2);
+			}
+			if (inner_cache[m] > best_delta) {
+				best_delta = inner_cache[m];
+				best_movement = movement;
+			}
+		}
+		for (Movement movement : movements_segment) {
+			int delta = segment_delta(movement);
+			if (delta > best_delta) {
+				best_delta = delta;
+				best_movement = movement;
+			}
+		}
+		for (int i = 0; i < n1; ++i) {
+			int *row = inter_cache.data() + static_cast<std::size_t>(i) * n2;
+			const bool near_row = near[0][i];
+			for (int j = 0; j < n2; ++j) {
+				if (near_row || near[1][j]) {
+					row[j] = inter_delta(i, j);
+				}
+				if (row[j] > best_delta) {
+					best_delta = row[j];
+					best_movement = {i, j, 1, 1, -1};
+				}
+			}
+		}
+		if (best_delta <= 0) {
+			break;
+		}
+
+		apply_movement(best_movement, best_movement.cycle);
+		std::fill(dirty[0].begin(), dirty[0].end(), 0);
+		std::fill(dirty[1].begin(), dirty[1].end(), 0);
+		const Movement &applied = best_movement;
+		switch (applied.type) {
+		case 0:
+			if (Vertex) {
+				mark(applied.cycle, applied.i, 1);
+				mark(applied.cycle, applied.j, 1);
+			} else {
+				mark(applied.cycle, applied.i, applied.j - applied.i + 1);
+			}
+			break;
+		case 1:
+			mark(0, applied.i, 1);
+			mark(1, applied.j, 1);
+			break;
+		case 2: // rotations may shift the whole cycle
+			mark(applied.cycle, 0, dirty[applied.cycle].size());
+			break;
+		default:
+			mark(0, applied.i, applied.length);
+			mark(1, applied.j, applied.length);
+		}
+	}
+}
+
+// Full neighbourhood search; every combination of acceptance and inner
+// neighbourhood gets its own kernel. Inner and inter moves are kept in
+// separate arrays, so the kernels need no dispatch on the move type -
+// greedy search shuffles the arrays once, then walks their concatenation
+// in a new RandomTraversal order every iteration. Steepest search goes
+// through steepest_scan. Segment moves (params.or_opt,
+// params.cross_exchange) form a third array.
+template <typename MatrixT>
+template <bool Steepest, bool Vertex>
+void TSP<MatrixT>::search() {
+	std::vector<Movement> movements_inner =
+		Vertex ? generate_all_vertex_movements(cycle1.size(), cycle2.size())
+			   : generate_all_edge_movements(cycle1.size(), cycle2.size());
+	std::vector<Movement> movements_inter;
+	std::vector<Movement> movements_segment;
+	if (params.or_opt || params.cross_exchange > 1) {
+		movements_segment = generate_all_segment_movements(
+			cycle1.size(), cycle2.size(), params.or_opt,
+			params.cross_exchange);
+	}
+	if constexpr (!Steepest) {
+		movements_inter =
+			generate_all_vertex_movements_inter(cycle1.size(), cycle2.size());
+		std::shuffle(movements_inner.begin(), movements_inner.end(), rng);
+		std::shuffle(movements_inter.begin(), movements_inter.end(), rng);
+		std::shuffle(movements_segment.begin(), movements_segment.end(), rng);
+	}
+
+	Movement best_movement;
+	int best_delta;
+	// greedy: stops at the first improving move of one random order over
+	// the three arrays together, so every move is equally likely to be
+	// tried first whatever the size of its array
+	const int inner_end = movements_inner.size();
+	const int inter_end = inner_end + movements_inter.size();
+	const int total = inter_end + movements_segment.size();
+	auto scan = [&] {
+		RandomTraversal order(total, rng);
+		for (int k = 0; k < total; ++k) {
+			const int index = order[k];
+			Movement movement;
+			int delta;
+			if (index < inner_end) {
+				movement = movements_inner[index];
+				delta = inner_delta<Vertex>(
+					movement.i, movement.j,
+					movement.cycle == 0 ? cycle1 : cycle2);
+			} else if (index < inter_end) {
+				movement = movements_inter[index - inner_end];
+				delta = inter_delta(movement.i, movement.j);
+			} else {
+				movement = movements_segment[index - inter_end];
+				delta = segment_delta(movement);
+			}
+			if (delta > best_delta) {
+				best_delta = delta;
+				best_movement = movement;
+				return;
+			}
+		}
+	};
 
 	do {
-		best_objective_value = 0;
-		best_cycle_num = -1;
+		best_delta = 0;
+		if constexpr (Steepest) {
+			steepest_scan<Vertex>(movements_inner, movements_segment,
+								  best_delta, best_movement);
+		} else {
+			scan();
+		}
+		if (best_delta > 0) {
+			apply_movement(best_movement, best_movement.cycle);
+		}
+	} while (best_delta > 0);
+}
+
+// First-improvement search with don't-look bits. Only vertices in the
+// active queue are scanned; a vertex without an improving move is dropped
+// from the queue, the endpoints of every applied move are put back, and the
+// search ends once no vertex is active.
+// The cycles are held as two-level lists (Tour), so the 2-opt reversals cost
+// O(sqrt n). A vertex v is tried against partners u - every vertex, starting
+// at a random one, or its params.candidates nearest neighbours:
+// - u in the same cycle: the two 2-opt moves creating edge (v, u) (edge),
+//   or swapping v and u (vertex),
+// - u in the other cycle: swapping v and u, or, with candidates, u with a
+//   neighbour of v or v with a neighbour of u, which puts u next to v.
+// With candidate lists every scan is O(k), so the search scales to very
+// large instances.
+template <typename MatrixT>
+template <bool Vertex>
+void TSP<MatrixT>::dont_look_search() {
+	const int n = dist_matrix.size();
+	Tour tours[2] = {Tour(cycle1, n), Tour(cycle2, n)};
+	const bool candidates = params.candidates > 0;
+	if (candidates && candidate_lists.empty()) {
+		candidate_lists = CandidateLists(dist_matrix, params.candidates);
+	}
+
+	std::vector<bool> active(n, false);
+	std::deque<int> queue;
+	auto wake = [&](int v) {
+		if (!active[v]) {
+			active[v] = true;
+			queue.push_back(v);
+		}
+	};
+	std::vector<int> order(cycle1);
+	order.insert(order.end(), cycle2.begin(), cycle2.end());
+	std::shuffle(order.begin(), order.end(), rng);
+	for (int v : order) {
+		wake(v);
+	}
+
+	std::vector<int> touched;
+	// 2-opt removing x -> x_next and y -> y_next, adding (x, y) and
+	// (x_next, y_next)
+	auto try_exchange = [&](Tour &tour, int x, int x_next, int y, int y_next) {
+		if (x == y || x_next == y || y_next == x)
+			return false;
+		if (dist_matrix(x, x_next) + dist_matrix(y, y_next) -
+				dist_matrix(x, y) - dist_matrix(x_next, y_next) <=
+			0)
+			return false;
+		tour.reverse(x_next, y);
+		touched = {x, x_next, y, y_next};
+		return true;
+	};
+	// a and b trade places - in one tour, or between the two
+	auto try_swap = [&](Tour &ta, int a, Tour &tb, int b) {
+		int a_prev = ta.prev(a), a_next = ta.next(a);
+		int b_prev = tb.prev(b), b_next = tb.next(b);
+		int delta;
+		if (&ta == &tb && (a_next == b || b_next == a)) {
+			if (b_next == a) {
+				std::swap(a, b);
+				std::swap(a_prev, b_prev);
+				std::swap(a_next, b_next);
+			}
+			if (b_next == a)
+				return false; // two vertex cycle
+			// a_prev a b b_next -> a_prev b a b_next
+			delta = dist_matrix(a_prev, a) + dist_matrix(b, b_next) -
+					dist_matrix(a_prev, b) - dist_matrix(a, b_next);
+		} else {
+			delta = dist_matrix(a_prev, a) + dist_matrix(a, a_next) +
+					dist_matrix(b_prev, b) + dist_matrix(b, b_next) -
+					dist_matrix(a_prev, b) - dist_matrix(b, a_next) -
+					dist_matrix(b_prev, a) - dist_matrix(a, b_next);
+		}
+		if (delta <= 0)
+			return false;
+		if (&ta == &tb) {
+			ta.swap(a, b);
+		} else {
+			ta.replace(a, b);
+			tb.replace(b, a);
+		}
+		touched = {a, a_prev, a_next, b, b_prev, b_next};
+		return true;
+	};
+	auto try_partner = [&](int v, int u) {
+		Tour &own = tours[0].contains(v) ? tours[0] : tours[1];
+		Tour &other = &own == &tours[0] ? tours[1] : tours[0];
+		if (u == v)
+			return false;
+		if (own.contains(u)) {
+			if constexpr (Vertex) {
+				return try_swap(own, v, own, u);
+			} else {
+				return try_exchange(own, v, own.next(v), u, own.next(u)) ||
+					   try_exchange(own, own.prev(v), v, own.prev(u), u);
+			}
+		}
+		if (!candidates) {
+			return try_swap(own, v, other, u);
+		}
+		return try_swap(own, own.next(v), other, u) ||
+			   try_swap(own, own.prev(v), other, u) ||
+			   try_swap(own, v, other, other.next(u)) ||
+			   try_swap(own, v, other, other.prev(u));
+	};
+
+	while (!queue.empty()) {
+		const int v = queue.front();
+		queue.pop_front();
+		active[v] = false;
+
+		bool improved = false;
+		if (candidates) {
+			const int *neighbours = candidate_lists.of(v);
+			const int k = candidate_lists.neighbours();
+			const int start = rng() % k;
+			for (int c = 0; c < k && !improved; ++c) {
+				improved = try_partner(v, neighbours[(start + c) % k]);
+			}
+		} else {
+			const int start = rng() % n;
+			for (int c = 0; c < n && !improved; ++c) {
+				improved = try_partner(v, (start + c) % n);
+			}
+		}
+		if (improved) {
+			for (int t : touched) {
+				wake(t);
+			}
+		}
+	}
+	cycle1 = tours[0].order();
+	cycle2 = tours[1].order();
+}
+
+// Records for every vertex which cycle it is in (0 / 1) and at which index.
+template <typename MatrixT>
+void TSP<MatrixT>::index_cycles(std::vector<int> &cycle_of,
+								std::vector<int> &position) {
+	for (int i = 0; i < cycle1.size(); ++i) {
+		cycle_of[cycle1[i]] = 0;
+		position[cycle1[i]] = i;
+	}
+	for (int i = 0; i < cycle2.size(); ++i) {
+		cycle_of[cycle2[i]] = 1;
+		position[cycle2[i]] = i;
+	}
+}
+
+// Candidate moves: only moves that introduce an edge (a, b), where b is one
+// of the k nearest neighbours of a, are evaluated - O(nk) per iteration
+// instead of O(n^2).
+// a, b in the same cycle: the two 2-opt moves creating edge (a, b), i.e.
+// reversing succ(a)..b or a..pred(b) (positions pa < pb).
+// a, b in different cycles: swapping b with pred(a) or succ(a), which puts b
+// right next to a.
+// With segment moves enabled also those placing b next to a
+// (candidate_segment_movements).
+template <typename MatrixT>
+void TSP<MatrixT>::candidate_search(bool steepest) {
+	if (candidate_lists.empty()) {
+		candidate_lists = CandidateLists(dist_matrix, params.candidates);
+	}
+	const int k = candidate_lists.neighbours();
+	std::vector<int> cycle_of(dist_matrix.size());
+	std::vector<int> position(dist_matrix.size());
+	std::vector<int> order(dist_matrix.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), rng);
+
+	std::vector<Movement> movements;
+	auto add_movements = [&](int a, int b) {
+		movements.clear();
+		int pa = position[a], pb = position[b];
+		const int n = (cycle_of[a] == 0 ? cycle1 : cycle2).size(); // of a
+		if (cycle_of[a] == cycle_of[b]) {
+			int lo = std::min(pa, pb), hi = std::max(pa, pb);
+			for (auto [i, j] : {std::pair{lo + 1, hi}, std::pair{lo, hi - 1}}) {
+				if (i < j && !(i == 0 && j == n - 1)) {
+					movements.push_back({i, j, 0, 0, int8_t(cycle_of[a])});
+				}
+			}
+		} else {
+			for (int side : {n - 1, 1}) {
+				int neighbour = (pa + side) % n;
+				if (cycle_of[a] == 0) {
+					movements.push_back({neighbour, pb, 1, 1, -1});
+				} else {
+					movements.push_back({pb, neighbour, 1, 1, -1});
+				}
+			}
+		}
+		if (params.or_opt || params.cross_exchange > 1) {
+			candidate_segment_movements(a, b, pa, pb, cycle_of, movements);
+		}
+	};
+
+	bool found_better;
+	do {
 		found_better = false;
-		std::shuffle(movements.begin(), movements.end(),
-					 std::mt19937(std::random_device()())); // shuffle movements
-		for (int iter = 0; iter < movements.size(); ++iter) {
-			std::tie(objective_value, cycle_num) =
-				get_delta(movements[iter]); // we need to remember chosen cycle
-											// for apply_movement method; type =
-											// 0 - cycle1, 1 - cycle2
-			if (objective_value > 0) { // better than current
-				//                std::cout << movements[iter][0] << " " <<
-				//                movements[iter][1] << " " <<
-				//                movements[iter][2] << " "
-				//                << cycle_num << std::endl;
-				found_better = true;
-				if (steepest) {
-					if (objective_value > best_objective_value) {
-						best_objective_value = objective_value;
-						best_movement = movements[iter];
+		index_cycles(cycle_of, position);
+		RandomTraversal walk(order.size(), rng);
+		Movement best_movement;
+		int best_delta = 0, best_cycle_num = -1;
+		for (int idx = 0; idx < order.size() && !(found_better && !steepest);
+			 ++idx) {
+			int a = order[walk[idx]];
+			const int *neighbours = candidate_lists.of(a);
+			for (int c = 0; c < k && !(found_better && !steepest); ++c) {
+				add_movements(a, neighbours[c]);
+				for (Movement movement : movements) {
+					auto [delta, cycle_num] = get_delta(movement);
+					if (delta > best_delta) {
+						best_delta = delta;
+						best_movement = movement;
 						best_cycle_num = cycle_num;
+						found_better = true;
+						if (!steepest) {
+							break;
+						}
 					}
-				} else {
-					apply_movement(movements[iter], cycle_num);
-					found_better = false;
-					break;
 				}
 			}
 		}
-		if (steepest && found_better) {
+		if (found_better) {
 			apply_movement(best_movement, best_cycle_num);
 		}
 	} while (found_better);
 }
 
+// List of moves (LM): improving moves survive between iterations instead of
+// being re-evaluated from scratch. Inner moves are always edge exchanges.
+// Before a stored move is applied its removed edges are looked up again:
+// - an edge no longer exists (or a swapped vertex got new neighbours): the
+//   move is dropped,
+// - both edges exist but only one of them is traversed in the stored
+//   direction: the move is not applicable now and stays in the list,
+// - otherwise it is applied.
+// After a move only the vertices whose neighbours changed get new moves.
+template <typename MatrixT> void TSP<MatrixT>::list_search() {
+	std::vector<int> cycle_of(dist_matrix.size());
+	std::vector<int> position(dist_matrix.size());
+	index_cycles(cycle_of, position);
+	auto cycle = [&](int v) -> std::vector<int> & {
+		return cycle_of[v] == 0 ? cycle1 : cycle2;
+	};
+	auto next = [&](int v) {
+		const std::vector<int> &c = cycle(v);
+		return c[(position[v] + 1) % c.size()];
+	};
+	auto prev = [&](int v) {
+		const std::vector<int> &c = cycle(v);
+		return c[(position[v] + c.size() - 1) % c.size()];
+	};
+
+	std::set<ListMove> moves;
+	auto add_exchange = [&](int a, int b) { // removes (a, next a), (b, next b)
+		int a_next = next(a), b_next = next(b);
+		if (a == b || a_next == b || b_next == a)
+			return;
+		int delta = dist_matrix(a, a_next) + dist_matrix(b, b_next) -
+					dist_matrix(a, b) - dist_matrix(a_next, b_next);
+		if (delta > 0) {
+			if (a > b) {
+				std::swap(a, b);
+				std::swap(a_next, b_next);
+			}
+			moves.insert({delta, 0, a, -1, a_next, b, -1, b_next});
+		}
+	};
+	auto add_swap = [&](int a, int b) { // a, b in different cycles
+		if (cycle_of[a] != 0)
+			std::swap(a, b);
+		int a_prev = prev(a), a_next = next(a);
+		int b_prev = prev(b), b_next = next(b);
+		int delta = dist_matrix(a_prev, a) + dist_matrix(a, a_next) +
+					dist_matrix(b_prev, b) + dist_matrix(b, b_next) -
+					dist_matrix(a_prev, b) - dist_matrix(b, a_next) -
+					dist_matrix(b_prev, a) - dist_matrix(a, b_next);
+		if (delta > 0) {
+			moves.insert({delta, 1, a, a_prev, a_next, b, b_prev, b_next});
+		}
+	};
+	auto add_moves = [&](int v) {
+		int v_prev = prev(v);
+		for (int u : cycle(v)) {
+			add_exchange(v, u);
+			add_exchange(v_prev, u);
+		}
+		for (int u : cycle_of[v] == 0 ? cycle2 : cycle1) {
+			add_swap(v, u);
+		}
+	};
+	auto has_edge = [&](int a, int b) {
+		return cycle_of[a] == cycle_of[b] && (next(a) == b || prev(a) == b);
+	};
+
+	for (int v : cycle1) {
+		add_moves(v);
+	}
+	for (int v : cycle2) {
+		add_moves(v);
+	}
+
+	std::vector<int> touched;
+	bool applied;
+	do {
+		applied = false;
+		for (auto it = moves.begin(); it != moves.end();) {
+			const ListMove move = *it;
+#ifdef CHECK_DELTAS
+			const int length_before = calculate_objective(cycle1, cycle2);
+#endif
+			if (move.type == 0) {
+				// after a swap the two edges may lie in different cycles
+				if (!has_edge(move.a, move.a_next) ||
+					!has_edge(move.b, move.b_next) ||
+					cycle_of[move.a] != cycle_of[move.b]) {
+					it = moves.erase(it);
+					continue;
+				}
+				bool a_forward = next(move.a) == move.a_next;
+				bool b_forward = next(move.b) == move.b_next;
+				if (a_forward != b_forward) {
+					++it;
+					continue;
+				}
+				// x -> x_next and y -> y_next in the current direction;
+				// reverse x_next..y, or the complementary y_next..x when the
+				// former wraps around the end of the vector.
+				int x = a_forward ? move.a : move.a_next;
+				int x_next = a_forward ? move.a_next : move.a;
+				int y = a_forward ? move.b : move.b_next;
+				int y_next = a_forward ? move.b_next : move.b;
+				int i = position[x_next], j = position[y];
+				if (i > j) {
+					i = position[y_next];
+					j = position[x];
+				}
+				int cycle_num = cycle_of[x];
+				apply_movement({i, j, 0, 0, int8_t(cycle_num)}, cycle_num);
+				std::vector<int> &c = cycle(x);
+				for (int k = i; k <= j; ++k) {
+					position[c[k]] = k;
+				}
+				touched = {x, x_next, y, y_next};
+			} else {
+				bool valid = cycle_of[move.a] == 0 && cycle_of[move.b] == 1;
+				for (auto [v, p, s] :
+					 {std::tuple{move.a, move.a_prev, move.a_next},
+					  std::tuple{move.b, move.b_prev, move.b_next}}) {
+					valid = valid && ((prev(v) == p && next(v) == s) ||
+									  (prev(v) == s && next(v) == p));
+				}
+				if (!valid) {
+					it = moves.erase(it);
+					continue;
+				}
+				apply_movement({position[move.a], position[move.b], 1, 1, -1},
+							   -1);
+				std::swap(cycle_of[move.a], cycle_of[move.b]);
+				std::swap(position[move.a], position[move.b]);
+				touched = {move.a, move.a_prev, move.a_next,
+						   move.b, move.b_prev, move.b_next};
+			}
+#ifdef CHECK_DELTAS
+			// every applied move has to shorten the cycles by its stored delta
+			const int gain =
+				length_before - calculate_objective(cycle1, cycle2);
+			if (gain != move.delta) {
+				std::cerr << "list_search: move of type " << move.type
+						  << " stored delta " << move.delta << ", real "
+						  << gain << std::endl;
+				std::abort();
+			}
+#endif
+			moves.erase(move);
+			for (int v : touched) {
+				add_moves(v);
+			}
+			applied = true;
+			break;
+		}
+	} while (applied);
+}
+
 // Function to perform local search
-auto TSP::local_search() -> std::tuple<std::vector<int>, std::vector<int>> {
+template <typename MatrixT>
+auto TSP<MatrixT>::local_search() -> std::tuple<std::vector<int>, std::vector<int>> {
 	// Types of input data for the cycles generation
 	if (params.input_data == "random") {
-		std::tie(cycle1, cycle2) = generate_random_cycles(100);
+		std::tie(cycle1, cycle2) = generate_random_cycles(dist_matrix.size());
 
 	} else if (params.input_data == "regret") {
 		std::tie(cycle1, cycle2) = find_greedy_cycles_regret();
 	    //std::tie(cycle1, cycle2) = find_greedy_cycles_nearest();
-    }
+    } else if (params.input_data == "split") {
+		std::tie(cycle1, cycle2) = generate_split_cycles();
+	}
 
 	bool vertex;
 	if (params.movements_type == "edge") {
@@ -222,7 +985,8 @@ auto TSP::local_search() -> std::tuple<std::vector<int>, std::vector<int>> {
 	return {cycle1, cycle2};
 }
 
-auto TSP::local_search(std::vector<int> c1, std::vector<int> c2)
+template <typename MatrixT>
+auto TSP<MatrixT>::local_search(std::vector<int> c1, std::vector<int> c2)
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	cycle1 = std::move(c1);
 	cycle2 = std::move(c2);
@@ -237,3 +1001,5 @@ auto TSP::local_search(std::vector<int> c1, std::vector<int> c2)
 
 	return {cycle1, cycle2};
 }
+
+INSTANTIATE_TSP
@@ -51,7 +51,8 @@ void has_duplicates(std::vector<int> &nums1, std::vector<int> &nums2) {
 	std::cout << "No duplicates found" << std::endl;
 }
 
-auto TSP::multiple_local_search()
+template <typename MatrixT>
+auto TSP<MatrixT>::multiple_local_search()
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	std::vector<int> best_cycle1, best_cycle2;
 	int best_objective_value = std::numeric_limits<int>::max();
@@ -103,7 +104,8 @@ Repeat
 To meet the stop conditions
 */
 
-auto TSP::iterative_local_search_one()
+template <typename MatrixT>
+auto TSP<MatrixT>::iterative_local_search_one()
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 
 	std::vector<int> cycle_x1, cycle_x2;
@@ -111,11 +113,13 @@ auto TSP::iterative_local_search_one()
 
 	// Generate the initial solution x
 	if (params.input_data == "random") {
-		std::tie(cycle_x1, cycle_x2) = generate_random_cycles(200);
+		std::tie(cycle_x1, cycle_x2) = generate_random_cycles(dist_matrix.size());
 
 	} else if (params.input_data == "regret") {
 //		std::tie(cycle_x1, cycle_x2) = find_greedy_cycles_regret();
         std::tie(cycle_x1, cycle_x2) = find_greedy_cycles_nearest();
+	} else if (params.input_data == "split") {
+		std::tie(cycle_x1, cycle_x2) = generate_split_cycles();
 	}
 
 	// Find average value of MSLS time
@@ -161,20 +165,19 @@ auto TSP::iterative_local_search_one()
 	return {cycle_x1, cycle_x2};
 }
 
-auto TSP::perturbation_one(std::vector<int> &c1, std::vector<int> &c2)
+template <typename MatrixT>
+auto TSP<MatrixT>::perturbation_one(std::vector<int> &c1, std::vector<int> &c2)
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	// Randomly select the number of vertices to be replaced
-	std::random_device rd;
-	std::mt19937 gen(rd());
 	std::uniform_int_distribution<int> num_vertices_dist(10, c1.size() / 8);
-	int num_vertices = num_vertices_dist(gen);
+	int num_vertices = num_vertices_dist(rng);
 
 	// Randomly select the vertices to be replaced
 	std::vector<int> vertices;
 	std::uniform_int_distribution<int> vertex_dist(
-		0, dist_matrix.x_coord.size() - 1);
+		0, dist_matrix.size() - 1);
 	while (vertices.size() < num_vertices) {
-		int vertex = vertex_dist(gen);
+		int vertex = vertex_dist(rng);
 		if (std::find(vertices.begin(), vertices.end(), vertex) ==
 			vertices.end()) {
 			vertices.push_back(vertex);
@@ -185,11 +188,11 @@ auto TSP::perturbation_one(std::vector<int> &c1, std::vector<int> &c2)
 	// movement type
 	for (int i = 0; i < vertices.size(); ++i) {
 		// Randomly select the vertex to be replaced
-		int j = vertex_dist(gen);
+		int j = vertex_dist(rng);
 
 		// Create random movement edge or vertex (0 or 1)
 		std::uniform_int_distribution<int> movement_type_dist(0, 1);
-		int movement_type = movement_type_dist(gen);
+		int movement_type = movement_type_dist(rng);
 
 		// Find the cycle in which the selected vertex is located
 		auto &num_cycle_i =
@@ -219,9 +222,9 @@ auto TSP::perturbation_one(std::vector<int> &c1, std::vector<int> &c2)
 				}
 			} else // Update the cycles(inter class)
 			{
-				int temp = c1[idx_i];
-				c1[idx_i] = c2[idx_j];
-				c2[idx_j] = temp;
+				// the indices belong to the cycles holding the vertices,
+				// which differ in size for an odd number of vertices
+				std::swap(num_cycle_i[idx_i], num_cycle_j[idx_j]);
 			}
 		}
 	}
@@ -260,18 +263,21 @@ Repeat
 To meet the stop conditions
 */
 
-auto TSP::iterative_local_search_two()
+template <typename MatrixT>
+auto TSP<MatrixT>::iterative_local_search_two()
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	std::vector<int> cycle_x1, cycle_x2;
 	std::vector<int> cycle_y1, cycle_y2;
 
 	// Generate the initial solution x
 	if (params.input_data == "random") {
-		std::tie(cycle_x1, cycle_x2) = generate_random_cycles(100);
+		std::tie(cycle_x1, cycle_x2) = generate_random_cycles(dist_matrix.size());
 
 	} else if (params.input_data == "regret") {
 		std::tie(cycle_x1, cycle_x2) = find_greedy_cycles_regret();
         //std::tie(cycle_x1, cycle_x2) = find_greedy_cycles_nearest();
+	} else if (params.input_data == "split") {
+		std::tie(cycle_x1, cycle_x2) = generate_split_cycles();
 	}
 
 	// Find avarage value of MSLS time
@@ -323,15 +329,15 @@ auto TSP::iterative_local_search_two()
 	return {cycle_x1, cycle_x2};
 }
 
-auto TSP::destroy_perturbation(std::vector<int> &c1, std::vector<int> &c2)
+template <typename MatrixT>
+auto TSP<MatrixT>::destroy_perturbation(std::vector<int> &c1, std::vector<int> &c2)
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	float coef = 0.5;
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<int> dist(0, c1.size() - 1);
+	std::uniform_int_distribution<int> dist1(0, c1.size() - 1);
+	std::uniform_int_distribution<int> dist2(0, c2.size() - 1);
 
-	int index1 = dist(gen);
-	int index2 = dist(gen);
+	int index1 = dist1(rng);
+	int index2 = dist2(rng);
 
 	int size1 = static_cast<int>(c1.size());
 	int size2 = static_cast<int>(c2.size());
@@ -371,10 +377,13 @@ auto TSP::destroy_perturbation(std::vector<int> &c1, std::vector<int> &c2)
 	return {c1, c2};
 }
 
-auto TSP::repair_perturbation(std::vector<int> &c1, std::vector<int> &c2)
+template <typename MatrixT>
+auto TSP<MatrixT>::repair_perturbation(std::vector<int> &c1, std::vector<int> &c2)
 	-> std::tuple<std::vector<int>, std::vector<int>> {
     find_greedy_cycles_regret_from_incomplete(c1, c2);  // REGRET
     // find_greedy_cycles_from_incomplete(c1, c2); // GREEDY CYCLES
     //find_greedy_cycles_nearest_from_incomplete(c1, c2); // NEAREST
     return {c1, c2};
-}
\ No newline at end of file
+}
+
+INSTANTIATE_TSP
@@ -0,0 +1,198 @@
+#include "../lib/tsp.h"
+
+// Segment moves (type 2 and 3 movements).
+//
+// Relocation (type 2, Or-opt, params.or_opt): the segment cycle[i..i+length)
+// is cut out and inserted between cycle[j] and cycle[j + 1], forward or
+// reversed. The reversed variant is the restricted 3-opt "segment
+// insertion".
+// Cross-exchange (type 3, params.cross_exchange): cycle1[i..i+length) and
+// cycle2[j..j+length) trade places, optionally both reversed. Moving a
+// segment to the other cycle would unbalance the cycle sizes, so segments
+// only cross between the cycles in equally long pairs; this lets a whole
+// cluster change cycles in one move instead of a chain of worse single
+// vertex swaps.
+// All positions are taken modulo the cycle size; every delta touches only
+// the segment ends and their neighbours, so it is O(1) for any length.
+
+template <typename MatrixT>
+auto TSP<MatrixT>::generate_all_segment_movements(int n1, int n2,
+												 bool relocation,
+												 int exchange_length)
+	-> std::vector<Movement> {
+	std::vector<Movement> movements;
+	for (int8_t cycle = 0; cycle < 2 && relocation; ++cycle) {
+		const int n = cycle == 0 ? n1 : n2;
+		for (int i = 0; i < n; ++i) {
+			for (int8_t length = 1; length <= max_segment; ++length) {
+				for (int j = 0; j < n; ++j) {
+					if (!valid_relocation(i, j, length, n))
+						continue;
+					movements.push_back({i, j, 2, 0, cycle, length, 0});
+					if (length > 1)
+						movements.push_back({i, j, 2, 0, cycle, length, 1});
+				}
+			}
+		}
+	}
+	// length 1 exchanges are the regular inter-cycle swaps
+	exchange_length =
+		std::min({exchange_length, n1 - 1, n2 - 1, max_exchange});
+	for (int i = 0; i < n1; ++i) {
+		for (int j = 0; j < n2; ++j) {
+			for (int length = 2; length <= exchange_length; ++length) {
+				for (int8_t reversed = 0; reversed < 2; ++reversed) {
+					movements.push_back(
+						{i, j, 3, 0, -1, int8_t(length), reversed});
+				}
+			}
+		}
+	}
+	return movements;
+}
+
+// cycle[j] must lie outside the segment and not be right in front of it.
+template <typename MatrixT>
+bool TSP<MatrixT>::valid_relocation(int i, int j, int length, int n) {
+	int offset = (j - i + n) % n;
+	return length + 2 <= n && offset >= length && offset <= n - 2;
+}
+
+template <typename MatrixT>
+int TSP<MatrixT>::segment_delta(Movement movement) const {
+	const int length = movement.length;
+	if (movement.type == 2) {
+		const std::vector<int> &cycle = movement.cycle == 0 ? cycle1 : cycle2;
+		const int n = cycle.size();
+		int before = cycle[(movement.i - 1 + n) % n];
+		int first = cycle[movement.i];
+		int last = cycle[(movement.i + length - 1) % n];
+		int after = cycle[(movement.i + length) % n];
+		int x = cycle[movement.j], y = cycle[(movement.j + 1) % n];
+		int deleted = dist_matrix(before, first) + dist_matrix(last, after) +
+					  dist_matrix(x, y);
+		int added = dist_matrix(before, after) +
+					(movement.reversed
+						 ? dist_matrix(x, last) + dist_matrix(first, y)
+						 : dist_matrix(x, first) + dist_matrix(last, y));
+		return deleted - added;
+	}
+
+	const int n1 = cycle1.size(), n2 = cycle2.size();
+	int before1 = cycle1[(movement.i - 1 + n1) % n1];
+	int first1 = cycle1[movement.i];
+	int last1 = cycle1[(movement.i + length - 1) % n1];
+	int after1 = cycle1[(movement.i + length) % n1];
+	int before2 = cycle2[(movement.j - 1 + n2) % n2];
+	int first2 = cycle2[movement.j];
+	int last2 = cycle2[(movement.j + length - 1) % n2];
+	int after2 = cycle2[(movement.j + length) % n2];
+	int deleted = dist_matrix(before1, first1) + dist_matrix(last1, after1) +
+				  dist_matrix(before2, first2) + dist_matrix(last2, after2);
+	int added = movement.reversed
+					? dist_matrix(before1, last2) + dist_matrix(first2, after1) +
+						  dist_matrix(before2, last1) +
+						  dist_matrix(first1, after2)
+					: dist_matrix(before1, first2) + dist_matrix(last2, after1) +
+						  dist_matrix(before2, first1) +
+						  dist_matrix(last1, after2);
+	return deleted - added;
+}
+
+template <typename MatrixT>
+void TSP<MatrixT>::apply_segment(Movement movement) {
+	const int length = movement.length;
+	auto reverse = [length](std::vector<int> &cycle, int first) {
+		const int n = cycle.size();
+		for (int k = 0; k < length / 2; ++k) {
+			std::swap(cycle[(first + k) % n],
+					  cycle[(first + length - 1 - k) % n]);
+		}
+	};
+
+	if (movement.type == 3) {
+		const int n1 = cycle1.size(), n2 = cycle2.size();
+		for (int k = 0; k < length; ++k) {
+			std::swap(cycle1[(movement.i + k) % n1],
+					  cycle2[(movement.j + k) % n2]);
+		}
+		if (movement.reversed) {
+			reverse(cycle1, movement.i);
+			reverse(cycle2, movement.j);
+		}
+		return;
+	}
+
+	std::vector<int> &cycle = movement.cycle == 0 ? cycle1 : cycle2;
+	const int n = cycle.size();
+	int i = movement.i, j = movement.j;
+	if (i + length > n) { // segment wraps around - rotate it to the front
+		std::rotate(cycle.begin(), cycle.begin() + i, cycle.end());
+		j = (j - i + n) % n;
+		i = 0;
+	}
+	int first;
+	if (j > i) {
+		std::rotate(cycle.begin() + i, cycle.begin() + i + length,
+					cycle.begin() + j + 1);
+		first = j - length + 1;
+	} else {
+		std::rotate(cycle.begin() + j + 1, cycle.begin() + i,
+					cycle.begin() + i + length);
+		first = j + 1;
+	}
+	if (movement.reversed) {
+		reverse(cycle, first);
+	}
+}
+
+// Segment moves creating edge (a, b), for candidate search; pa, pb are the
+// positions of a and b, cycle_of holds the cycle of every vertex.
+template <typename MatrixT>
+void TSP<MatrixT>::candidate_segment_movements(
+	int a, int b, int pa, int pb, const std::vector<int> &cycle_of,
+	std::vector<Movement> &movements) {
+	const int na = (cycle_of[a] == 0 ? cycle1 : cycle2).size();
+	const int nb = (cycle_of[b] == 0 ? cycle1 : cycle2).size();
+	if (cycle_of[a] == cycle_of[b]) {
+		if (!params.or_opt)
+			return;
+		const int n = na;
+		const int8_t cycle = cycle_of[a];
+		for (int8_t length = 1; length <= max_segment; ++length) {
+			int starting = pb, ending = (pb - length + 1 + n) % n;
+			int after_a = pa, before_a = (pa - 1 + n) % n;
+			// x = a: b leads the segment, or ends it and gets reversed;
+			// y = a: the other way round
+			for (auto [i, j, reversed] : {std::tuple{starting, after_a, 0},
+										  std::tuple{ending, after_a, 1},
+										  std::tuple{ending, before_a, 0},
+										  std::tuple{starting, before_a, 1}}) {
+				if ((length > 1 || reversed == 0) &&
+					valid_relocation(i, j, length, n)) {
+					movements.push_back(
+						{i, j, 2, 0, cycle, length, int8_t(reversed)});
+				}
+			}
+		}
+		return;
+	}
+	const int exchange_length =
+		std::min({params.cross_exchange, na - 1, nb - 1, max_exchange});
+	for (int length = 2; length <= exchange_length; ++length) {
+		int after_a = (pa + 1) % na, before_a = (pa - length + na) % na;
+		int starting = pb, ending = (pb - length + 1 + nb) % nb;
+		for (auto [sa, sb, reversed] : {std::tuple{after_a, starting, 0},
+										std::tuple{before_a, ending, 0},
+										std::tuple{after_a, ending, 1},
+										std::tuple{before_a, starting, 1}}) {
+			Movement movement{sa, sb, 3, 0, -1, int8_t(length), int8_t(reversed)};
+			if (cycle_of[a] != 0) {
+				std::swap(movement.i, movement.j);
+			}
+			movements.push_back(movement);
+		}
+	}
+}
+
+INSTANTIATE_TSP
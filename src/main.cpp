@@ -1,8 +1,15 @@
+#include "../lib/cache.h"
 #include "../lib/tsp.h"
 #include <iostream>
+#include <limits>
+#include <map>
 #include <vector>
 
-void generate_cycles(TSP tsp) {
+// Full n x n matrices larger than this are stored as a packed triangle, and
+// instances whose packed triangle would still exceed it use DistanceOracle.
+constexpr std::size_t full_matrix_budget = std::size_t(1) << 30;
+
+template <typename MatrixT> void generate_cycles(TSP<MatrixT> tsp) {
 	auto [cycle1, cycle2] = tsp.solve();
 
 	for (int vertex : cycle1) {
@@ -43,61 +50,221 @@ AlgType choose_algo(std::string algo) {
 	}
 }
 
-int main(int argc, char *argv[]) {
-
-	// NEAREST | EXPANSION | REGRET |
-	if (argc >= 3 && argc < 6) {
-		Matrix m;
-		m.load_from_path(argv[1]);
-		m.generate_dist_matrix();
-		AlgType alg_type = choose_algo(std::string(argv[2]));
-		TSP tsp(m, alg_type);
-		generate_cycles(tsp);
-		return 0;
+// Removes "--name=value" options from argv, so the positional arguments
+// keep their places, and returns them by name.
+std::map<std::string, std::string> extract_options(int &argc, char *argv[]) {
+	std::map<std::string, std::string> options;
+	int kept = 0;
+	for (int i = 0; i < argc; i++) {
+		std::string arg = argv[i];
+		std::size_t eq = arg.find('=');
+		if (i > 0 && arg.rfind("--", 0) == 0 && eq != std::string::npos) {
+			options[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+		} else {
+			argv[kept++] = argv[i];
+		}
+	}
+	argc = kept;
+	return options;
+}
 
-	} else if (argc < 3) {
-		std::cerr
-			<< "Usage: " << argv[0]
-			<< " <filename> <algotype> {nearest, expansion, regret} [start_idx]"
-			<< std::endl;
-		return 1;
+// main_search takes the first of move_list, dont_look, candidates and
+// delta_cache that applies, and each variant searches a fixed neighbourhood,
+// so options it would ignore are rejected instead of silently dropped. The
+// thread pool only runs the full steepest scan and regret insertion. The
+// constructors take no local search options at all.
+bool check_options(const LocalSearchParams &params, AlgType alg_type) {
+	const bool constructor = alg_type == AlgType::nearest_neighbors ||
+							 alg_type == AlgType::greedy_cycle ||
+							 alg_type == AlgType::regret;
+	const bool vertex = params.movements_type == "vertex";
+	const bool segments = params.or_opt || params.cross_exchange > 1;
+	const bool steepest_scan = !constructor && params.steepest &&
+							   !params.move_list && !params.dont_look &&
+							   params.candidates == 0 && !params.delta_cache;
+	const bool regret_insertion =
+		alg_type == AlgType::regret || params.input_data == "regret" ||
+		alg_type == AlgType::ils2 ||
+		(alg_type == AlgType::hea && !params.fragment_rebuild);
+	std::string error;
+	if (constructor && (params.move_list || params.dont_look ||
+						params.candidates > 0 || params.delta_cache ||
+						segments)) {
+		error = "--move_list, --dont_look, --candidates, --delta_cache, "
+				"--or_opt and --cross_exchange apply to local search only";
+	} else if (params.move_list) {
+		if (!params.steepest || vertex) {
+			error = "--move_list runs steepest search with edge moves only";
+		} else if (params.candidates > 0 || params.dont_look ||
+				   params.delta_cache || segments) {
+			error = "--move_list cannot be combined with --candidates, "
+					"--dont_look, --delta_cache, --or_opt or --cross_exchange";
+		}
+	} else if (params.dont_look) {
+		if (params.steepest) {
+			error = "--dont_look runs greedy search only";
+		} else if (params.delta_cache || segments) {
+			error = "--dont_look cannot be combined with --delta_cache, "
+					"--or_opt or --cross_exchange";
+		}
+	} else if (params.candidates > 0) {
+		if (vertex) {
+			error = "--candidates without --dont_look uses edge moves only";
+		} else if (params.delta_cache) {
+			error = "--candidates cannot be combined with --delta_cache";
+		}
+	} else if (params.delta_cache && !params.steepest) {
+		error = "--delta_cache runs steepest search only";
+	}
+	if (error.empty() && params.threads > 1 && !steepest_scan &&
+		!regret_insertion) {
+		error = "--threads is used only by the full steepest search and "
+				"regret insertion";
+	}
+	if (error.empty() && params.fragment_rebuild &&
+		alg_type != AlgType::hea) {
+		error = "--fragment_rebuild is used by hea only";
+	}
+	if (!error.empty()) {
+		std::cerr << "Unsupported options: " << error << std::endl;
+		return false;
 	}
+	return true;
+}
 
-	// LOCAL
+template <typename MatrixT>
+int run(MatrixT &m, int argc, char *argv[],
+		std::map<std::string, std::string> &options) {
+	AlgType alg_type = choose_algo(std::string(argv[2]));
+	LocalSearchParams params{};
+	params.filename = argv[1];
+	// NEAREST | EXPANSION | REGRET take only --threads and --seed
 	if (argc >= 6) {
-
-		Matrix m;
-		m.load_from_path(argv[1]);
-		m.generate_dist_matrix();
-		LocalSearchParams params;
-		params.filename = argv[1];
+		// LOCAL
 		params.input_data = std::string(argv[3]);
 		params.movements_type = std::string(argv[4]);
 		params.steepest = std::stoi(argv[5]);
+	}
+	if (options.count("candidates")) {
+		params.candidates = std::stoi(options["candidates"]);
+	}
+	if (options.count("move_list")) {
+		params.move_list = std::stoi(options["move_list"]);
+	}
+	if (options.count("threads")) {
+		params.threads = std::stoi(options["threads"]);
+	}
+	if (options.count("or_opt")) {
+		params.or_opt = std::stoi(options["or_opt"]);
+	}
+	if (options.count("cross_exchange")) {
+		params.cross_exchange = std::stoi(options["cross_exchange"]);
+	}
+	if (options.count("delta_cache")) {
+		params.delta_cache = std::stoi(options["delta_cache"]);
+	}
+	if (options.count("fragment_rebuild")) {
+		params.fragment_rebuild = std::stoi(options["fragment_rebuild"]);
+	}
+	if (options.count("dont_look")) {
+		params.dont_look = std::stoi(options["dont_look"]);
+	}
+	if (options.count("seed")) {
+		params.seed = std::stoul(options["seed"]);
+	}
 
-		AlgType alg_type = choose_algo(std::string(argv[2]));
-		if (alg_type == AlgType::hea || alg_type == AlgType::ils2) {
-			params.using_local_search = std::stoi(argv[6]);			
-			TSP tsp(m, alg_type, params.input_data, params.movements_type,
-					params.steepest, params.using_local_search, params.filename);
+	if (argc >= 6 &&
+		(alg_type == AlgType::hea || alg_type == AlgType::ils2)) {
+		params.using_local_search = std::stoi(argv[6]);
+	}
+	if (!check_options(params, alg_type)) {
+		return 1;
+	}
+	TSP<MatrixT> tsp(m, alg_type, params);
+	generate_cycles(tsp);
+	return 0;
+}
 
-			generate_cycles(tsp);
-			return 0;
+// Maps the cached matrix when it matches the requested element type and
+// storage; otherwise takes over the instance parsed into `loaded`, builds the
+// matrix and refreshes the cache for the next run.
+template <typename T, template <typename> class Storage>
+int run_as(Instance &loaded, const std::string &cache, uint64_t source_hash,
+		   int argc, char *argv[],
+		   std::map<std::string, std::string> &options) {
+	Matrix<T, Storage> m;
+	if (!m.map_cache(cache, source_hash)) {
+		if (loaded.size() == 0 && !loaded.load_from_path(argv[1])) {
+			return 1;
 		}
-		// Print alg_type
-		TSP tsp(m, alg_type, params.input_data, params.movements_type,
-				params.steepest, params.filename);
-		generate_cycles(tsp);
-		return 0;
-	} else if (argc < 6) {
+		static_cast<Instance &>(m) = std::move(loaded);
+		m.generate_dist_matrix();
+		m.write_cache(cache, source_hash);
+	}
+	return run(m, argc, argv, options);
+}
+
+int main(int argc, char *argv[]) {
+	auto options = extract_options(argc, argv);
+	if (argc < 3) {
+		std::cerr
+			<< "Usage: " << argv[0]
+			<< " <filename> <algotype> {nearest, expansion, regret} [start_idx]"
+			<< std::endl;
 		std::cerr << "Usage: " << argv[0]
 				  << " <instance_path> <algotype> [nearest, expansion, regret, "
 					 "local, msls, ils1, ils2, hea ]"
-				  << " <input_data> [random, regret] <movements_type> [inner, "
-					 "inter] <greedy/steepest> [0, 1] "
+				  << " <input_data> [random, regret, split] <movements_type> [inner, "
+					 "inter] <greedy/steepest> [0, 1] [--candidates=K] "
+					 "[--move_list=1] [--dont_look=1] [--or_opt=1] "
+					 "[--cross_exchange=L] [--delta_cache=1] "
+					 "[--fragment_rebuild=1] [--threads=N] [--seed=S]"
 				  << std::endl;
 		return 1;
 	}
 
-	return 0;
-}
\ No newline at end of file
+	// A valid cache already records which storage the instance needs, so the
+	// .tsp text is only parsed on a cache miss.
+	std::string cache = cache_path(argv[1]);
+	uint64_t source_hash = hash_file(argv[1]);
+	CacheHeader header;
+	Instance instance;
+	bool narrow, packed, on_demand = false;
+	if (read_cache_header(cache, source_hash, header)) {
+		narrow = header.element_size == sizeof(uint16_t);
+		packed = header.triangular;
+	} else {
+		// Use 16-bit distances whenever the instance allows it - this halves
+		// the matrix footprint and keeps larger instances inside the cache.
+		// Matrices that would not fit the memory budget are kept as a packed
+		// triangle.
+		if (!instance.load_from_path(argv[1])) {
+			return 1;
+		}
+		auto [lowest, highest] = instance.distance_range();
+		narrow = lowest >= 0 &&
+				 highest <= std::numeric_limits<uint16_t>::max();
+		std::size_t n = instance.size();
+		std::size_t element = narrow ? sizeof(uint16_t) : sizeof(int32_t);
+		packed = n * n * element > full_matrix_budget;
+		on_demand = n * (n + 1) / 2 * element > full_matrix_budget &&
+					instance.weight_type != EdgeWeightType::explicit_weights;
+	}
+
+	if (on_demand) {
+		DistanceOracle oracle;
+		static_cast<Instance &>(oracle) = std::move(instance);
+		return run(oracle, argc, argv, options);
+	}
+
+	if (narrow) {
+		return packed ? run_as<uint16_t, TriangularMatrix>(
+							instance, cache, source_hash, argc, argv, options)
+					  : run_as<uint16_t, DistMatrix>(
+							instance, cache, source_hash, argc, argv, options);
+	}
+	return packed ? run_as<int32_t, TriangularMatrix>(
+						instance, cache, source_hash, argc, argv, options)
+				  : run_as<int32_t, DistMatrix>(instance, cache, source_hash,
+												argc, argv, options);
+}
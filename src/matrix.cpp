@@ -1,45 +1,134 @@
 #include "../lib/matrix.h"
-#include "../src/utils.cpp"
+#include "../lib/cache.h"
 
-Matrix::Matrix() {}
+template <typename T, template <typename> class Storage>
+Matrix<T, Storage>::Matrix() {}
 
-void Matrix::load_from_path(std::string path) {
-	std::ifstream file(path);
-	if (!file.is_open()) {
-		std::cerr << "Error opening file." << std::endl;
-		return;
-	}
-	std::string line;
-	bool reading_coords = false;
-	while (std::getline(file, line) && line != "EOF") {
-		if (line == "NODE_COORD_SECTION") {
-			reading_coords = true;
-			continue;
-		}
-		if (!reading_coords) {
-			continue;
-		}
-		std::vector<std::string> tokens = splitString(line, ' ');
-		if (tokens.size() >= 3) {
-			this->x_coord.push_back(std::stoi(tokens[1]));
-			this->y_coord.push_back(std::stoi(tokens[2]));
+// Fills the matrix row by row. Rows are handed out to worker threads in
+// blocks through a shared counter, which keeps the load balanced for the
+// triangular storage where row lengths grow with i.
+template <typename T, template <typename> class Storage>
+void Matrix<T, Storage>::generate_dist_matrix() {
+	const int n = this->dimension;
+	const int rows_per_block = 64;
+	this->dist_matrix = Storage<T>(n);
+
+	std::atomic<int> next_block{0};
+	auto worker = [&]() {
+		int first;
+		while ((first = next_block.fetch_add(rows_per_block)) < n) {
+			int last = std::min(first + rows_per_block, n);
+			for (int i = first; i < last; i++) {
+				this->fill_row(i);
+			}
 		}
+	};
+
+	int num_threads =
+		std::min<int>(std::max(1u, std::thread::hardware_concurrency()),
+					  (n + rows_per_block - 1) / rows_per_block);
+	std::vector<std::thread> threads;
+	for (int t = 1; t < num_threads; t++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : threads) {
+		thread.join();
 	}
-	file.close();
 }
 
-void Matrix::generate_dist_matrix() {
-	for (int i = 0; i < this->x_coord.size(); i++) {
-		std::vector<int> row;
-		for (int j = 0; j < this->x_coord.size(); j++) {
-			int dist = this->calc_distance(this->x_coord[i], this->y_coord[i],
-										   this->x_coord[j], this->y_coord[j]);
-			row.push_back(dist);
+// Computes d(i, j) for the whole stored part of row i. EUC_2D and CEIL_2D
+// rows produce four distances per iteration with AVX2 (one vsqrtpd); the
+// other metrics, the scalar tail and non-AVX2 builds go through
+// Instance::calc_distance.
+template <typename T, template <typename> class Storage>
+void Matrix<T, Storage>::fill_row(int i) {
+	T *row = this->dist_matrix.row(i);
+	const int len = this->dist_matrix.row_size(i);
+	int j = 0;
+
+#ifdef __AVX2__
+	const bool ceil = this->weight_type == EdgeWeightType::ceil_2d;
+	if (ceil || this->weight_type == EdgeWeightType::euc_2d) {
+		const double *xs = this->x_coord.data();
+		const double *ys = this->y_coord.data();
+		const __m256d xi = _mm256_set1_pd(xs[i]);
+		const __m256d yi = _mm256_set1_pd(ys[i]);
+		const __m256d half = _mm256_set1_pd(0.5);
+		for (; j + 4 <= len; j += 4) {
+			__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + j), xi);
+			__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + j), yi);
+			__m256d dist = _mm256_sqrt_pd(
+				_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+			dist = ceil ? _mm256_ceil_pd(dist) : _mm256_add_pd(dist, half);
+			__m128i rounded = _mm256_cvttpd_epi32(dist);
+			if constexpr (sizeof(T) == sizeof(uint16_t)) {
+				_mm_storel_epi64((__m128i *)(row + j),
+								 _mm_packus_epi32(rounded, rounded));
+			} else {
+				_mm_storeu_si128((__m128i *)(row + j), rounded);
+			}
 		}
-		this->dist_matrix.push_back(row);
 	}
+#endif
+
+	for (; j < len; j++) {
+		row[j] = this->calc_distance(i, j);
+	}
+}
+
+// Adopts a cache written by write_cache: the coordinates are copied, the
+// distance matrix is used in place from the read-only mapping. Returns false
+// when the cache is missing, stale or was written for a different storage.
+template <typename T, template <typename> class Storage>
+bool Matrix<T, Storage>::map_cache(const std::string &path,
+								   uint64_t source_hash) {
+	auto file = MappedFile::open(path);
+	if (!file || file->size() < sizeof(CacheHeader)) {
+		return false;
+	}
+	CacheHeader header;
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (!valid_cache_header(header, source_hash, file->size()) ||
+		header.element_size != sizeof(T) ||
+		header.triangular != Storage<T>::triangular ||
+		header.matrix_bytes != Storage<T>::elements(header.n) * sizeof(T)) {
+		return false;
+	}
+
+	int n = header.n;
+	auto coords =
+		reinterpret_cast<const double *>(file->data() + header.coords_offset);
+	this->dimension = n;
+	this->weight_type = static_cast<EdgeWeightType>(header.weight_type);
+	this->x_coord.assign(coords, coords + header.coords_count);
+	this->y_coord.assign(coords + header.coords_count,
+						 coords + 2 * header.coords_count);
+	this->weights.clear();
+	T *values = reinterpret_cast<T *>(
+		const_cast<char *>(file->data() + header.matrix_offset));
+	this->dist_matrix = Storage<T>(n, std::shared_ptr<T>(file, values));
+	return true;
 }
 
-int Matrix::calc_distance(int x1, int y1, int x2, int y2) {
-	return round(std::sqrt(std::pow(x2 - x1, 2) + std::pow(y2 - y1, 2)));
+template <typename T, template <typename> class Storage>
+void Matrix<T, Storage>::write_cache(const std::string &path,
+									 uint64_t source_hash) const {
+	CacheHeader header{};
+	header.element_size = sizeof(T);
+	header.triangular = Storage<T>::triangular;
+	header.weight_type = static_cast<uint32_t>(this->weight_type);
+	header.n = this->dimension;
+	header.coords_count = this->x_coord.size();
+	header.source_hash = source_hash;
+	header.matrix_bytes = Storage<T>::elements(header.n) * sizeof(T);
+	if (!write_cache_file(path, header, this->x_coord, this->y_coord,
+						  this->dist_matrix.data())) {
+		std::cerr << "Could not write instance cache " << path << std::endl;
+	}
 }
+
+template class Matrix<uint16_t>;
+template class Matrix<int32_t>;
+template class Matrix<uint16_t, TriangularMatrix>;
+template class Matrix<int32_t, TriangularMatrix>;
@@ -0,0 +1,236 @@
+#include "../lib/neighbors.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <queue>
+
+SpatialGrid::SpatialGrid(const std::vector<double> &x_coord,
+						 const std::vector<double> &y_coord)
+	: x(x_coord.data()), y(y_coord.data()), slot(x_coord.size()) {
+	std::vector<int> points(x_coord.size());
+	std::iota(points.begin(), points.end(), 0);
+	build(points);
+}
+
+// Lays the grid out over `points` only; other points are not present.
+void SpatialGrid::build(const std::vector<int> &points) {
+	const int n = points.size();
+	live = n;
+	std::fill(slot.begin(), slot.end(), -1);
+	if (n == 0) {
+		cols = rows = 1;
+		cell_start.assign(2, 0);
+		cell_count.assign(1, 0);
+		items.clear();
+		return;
+	}
+	double lo_x = x[points[0]], hi_x = lo_x, lo_y = y[points[0]], hi_y = lo_y;
+	for (int v : points) {
+		lo_x = std::min(lo_x, x[v]);
+		hi_x = std::max(hi_x, x[v]);
+		lo_y = std::min(lo_y, y[v]);
+		hi_y = std::max(hi_y, y[v]);
+	}
+	min_x = lo_x;
+	min_y = lo_y;
+	double width = std::max(hi_x - min_x, 1e-9);
+	double height = std::max(hi_y - min_y, 1e-9);
+
+	// About two points per cell, with cells as square as the box allows.
+	double cells = std::max(1.0, n / 2.0);
+	cols = std::max(1, (int)std::ceil(std::sqrt(cells * width / height)));
+	rows = std::max(1, (int)std::ceil(cells / cols));
+	cell_w = width / cols * (1 + 1e-9);
+	cell_h = height / rows * (1 + 1e-9);
+
+	cell_start.assign(cols * rows + 1, 0);
+	std::vector<int> cell(n);
+	for (int i = 0; i < n; i++) {
+		cell[i] = cell_of(x[points[i]], y[points[i]]);
+		cell_start[cell[i] + 1]++;
+	}
+	for (int c = 0; c < cols * rows; c++) {
+		cell_start[c + 1] += cell_start[c];
+	}
+	cell_count.resize(cols * rows);
+	for (int c = 0; c < cols * rows; c++) {
+		cell_count[c] = cell_start[c + 1] - cell_start[c];
+	}
+	items.resize(n);
+	std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+	for (int i = 0; i < n; i++) {
+		slot[points[i]] = fill[cell[i]]++;
+		items[slot[points[i]]] = points[i];
+	}
+}
+
+int SpatialGrid::cell_of(double px, double py) const {
+	int cx = std::clamp((int)((px - min_x) / cell_w), 0, cols - 1);
+	int cy = std::clamp((int)((py - min_y) / cell_h), 0, rows - 1);
+	return cy * cols + cx;
+}
+
+// Lower bound on the distance from a point in the centre cell to any cell
+// of ring r + 1.
+double SpatialGrid::ring_clearance(int r) const {
+	return r * std::min(cell_w, cell_h);
+}
+
+// Calls visit(point) for every point still present in the cells at Chebyshev
+// distance exactly r from cell (cx, cy).
+template <typename Visit>
+void SpatialGrid::visit_ring(int cx, int cy, int r, Visit visit) const {
+	for (int gy = std::max(0, cy - r); gy <= std::min(rows - 1, cy + r); gy++) {
+		bool edge_row = gy == cy - r || gy == cy + r;
+		int step = edge_row ? 1 : 2 * r;
+		for (int gx = cx - r; gx <= cx + r; gx += std::max(step, 1)) {
+			if (gx < 0 || gx >= cols) {
+				continue;
+			}
+			int c = gy * cols + gx;
+			for (int s = cell_start[c]; s < cell_start[c] + cell_count[c];
+				 s++) {
+				visit(items[s]);
+			}
+		}
+	}
+}
+
+// Nearest point still in the grid to (px, py), or -1 if the grid is empty.
+int SpatialGrid::nearest(double px, double py) const {
+	if (live == 0) {
+		return -1;
+	}
+	int c = cell_of(px, py);
+	int cx = c % cols, cy = c / cols;
+	int best = -1;
+	double best_dist = std::numeric_limits<double>::max();
+	int max_r = std::max(cols, rows);
+	for (int r = 0; r <= max_r; r++) {
+		visit_ring(cx, cy, r, [&](int v) {
+			double dx = x[v] - px, dy = y[v] - py;
+			double dist = dx * dx + dy * dy;
+			if (dist < best_dist || (dist == best_dist && v < best)) {
+				best_dist = dist;
+				best = v;
+			}
+		});
+		double clearance = ring_clearance(r);
+		if (best >= 0 && clearance * clearance > best_dist) {
+			break;
+		}
+	}
+	return best;
+}
+
+// Point still in the grid with the least |ua| + |ub|, i.e. the cheapest to
+// insert into edge (a, b). Since |ua| + |ub| >= 2 |um| for the midpoint m,
+// the rings around m stop once twice their clearance exceeds the best sum.
+int SpatialGrid::nearest_to_both(int a, int b) const {
+	if (live == 0) {
+		return -1;
+	}
+	const double mx = (x[a] + x[b]) / 2, my = (y[a] + y[b]) / 2;
+	int c = cell_of(mx, my);
+	int cx = c % cols, cy = c / cols;
+	int best = -1;
+	double best_sum = std::numeric_limits<double>::max();
+	int max_r = std::max(cols, rows);
+	for (int r = 0; r <= max_r; r++) {
+		visit_ring(cx, cy, r, [&](int v) {
+			double sum = std::hypot(x[v] - x[a], y[v] - y[a]) +
+						 std::hypot(x[v] - x[b], y[v] - y[b]);
+			if (sum < best_sum || (sum == best_sum && v < best)) {
+				best_sum = sum;
+				best = v;
+			}
+		});
+		if (best >= 0 && 2 * ring_clearance(r) > best_sum) {
+			break;
+		}
+	}
+	return best;
+}
+
+// The k points nearest to point v (v itself excluded), nearest first.
+void SpatialGrid::k_nearest(int v, int k, std::vector<int> &out) const {
+	out.clear();
+	int c = cell_of(x[v], y[v]);
+	int cx = c % cols, cy = c / cols;
+	std::priority_queue<std::pair<double, int>> heap; // farthest on top
+	int max_r = std::max(cols, rows);
+	for (int r = 0; r <= max_r; r++) {
+		visit_ring(cx, cy, r, [&](int u) {
+			if (u == v) {
+				return;
+			}
+			double dx = x[u] - x[v], dy = y[u] - y[v];
+			std::pair<double, int> entry{dx * dx + dy * dy, u};
+			if ((int)heap.size() < k) {
+				heap.push(entry);
+			} else if (entry < heap.top()) {
+				heap.pop();
+				heap.push(entry);
+			}
+		});
+		double clearance = ring_clearance(r);
+		if ((int)heap.size() == k && clearance * clearance > heap.top().first) {
+			break;
+		}
+	}
+	out.resize(heap.size());
+	for (int i = out.size() - 1; i >= 0; i--) {
+		out[i] = heap.top().second;
+		heap.pop();
+	}
+}
+
+// Drops v from the grid by swapping it with the last live point of its cell.
+void SpatialGrid::remove(int v) {
+	if (slot[v] < 0) {
+		return;
+	}
+	int c = cell_of(x[v], y[v]);
+	int last = cell_start[c] + --cell_count[c];
+	int moved = items[last];
+	items[slot[v]] = moved;
+	slot[moved] = slot[v];
+	items[last] = v;
+	slot[v] = -1;
+	live--;
+	if (live > 0 && live * 4 < (int)items.size()) {
+		std::vector<int> points;
+		points.reserve(live);
+		for (int c = 0; c < cols * rows; c++) {
+			points.insert(points.end(), items.begin() + cell_start[c],
+						  items.begin() + cell_start[c] + cell_count[c]);
+		}
+		build(points);
+	}
+}
+
+bool CandidateLists::from_grid(const Instance &instance, int neighbours) {
+	const int n = instance.size();
+	k = std::max(0, std::min(neighbours, n - 1));
+	lists.resize(static_cast<std::size_t>(n) * k);
+
+	bool planar = !instance.x_coord.empty() &&
+				  instance.weight_type != EdgeWeightType::geo;
+	if (!planar) {
+		return false;
+	}
+	SpatialGrid grid(instance.x_coord, instance.y_coord);
+	std::vector<int> found;
+	for (int v = 0; v < n; v++) {
+		grid.k_nearest(v, k, found);
+		std::copy(found.begin(), found.end(),
+				  lists.begin() + static_cast<std::size_t>(v) * k);
+	}
+	return true;
+}
+
+bool CandidateLists::contains(int v, int u) const {
+	const int *list = of(v);
+	return std::find(list, list + k, u) != list + k;
+}
@@ -0,0 +1,189 @@
+#include "../lib/indexed_heap.h"
+#include "../lib/tsp.h"
+
+// Weighted 2-regret insertion (regret - coef * best cost) completing c1 and
+// c2; the shorter cycle takes the next vertex.
+//
+// Inserting v into edge (a, b) only removes that edge and adds (a, v) and
+// (v, b), so for every unvisited vertex the two cheapest insertion edges
+// into each cycle are cached (an edge is identified by its first vertex)
+// and updated from the two new edges alone. The whole cycle is scanned
+// again only when the removed edge was one of the cached two. The vertex
+// with the largest regret of each cycle comes from an indexed heap. One
+// insertion costs O(n log n) instead of O(n^2) plus allocations.
+//
+// With params.threads > 1 the unvisited vertices are split into blocks
+// updated on the thread pool; each block also finds its largest regret for
+// the next insertion and the blocks are reduced in order. Ties go to the
+// smaller id as in the heap, so the cycles do not depend on the number of
+// threads.
+template <typename MatrixT>
+void TSP<MatrixT>::regret_insertion(std::vector<int> &c1, std::vector<int> &c2,
+									float coef) {
+	const int n = dist_matrix.size();
+	struct Insertion {
+		int cost = 0, edge = -1; // edge -1 - none
+	};
+	// per cycle and vertex: cheapest and second cheapest insertion
+	std::vector<Insertion> best[2] = {std::vector<Insertion>(n),
+									  std::vector<Insertion>(n)};
+	std::vector<Insertion> second[2] = {std::vector<Insertion>(n),
+										std::vector<Insertion>(n)};
+	IndexedHeap regrets[2] = {IndexedHeap(n), IndexedHeap(n)};
+	std::vector<int> next(n, -1);
+	std::vector<int> unvisited;
+	int head[2] = {-1, -1}, size[2] = {0, 0};
+
+	const std::vector<int> *cycles[2] = {&c1, &c2};
+	for (int c = 0; c < 2; ++c) {
+		const std::vector<int> &cycle = *cycles[c];
+		size[c] = cycle.size();
+		if (!cycle.empty()) {
+			head[c] = cycle.front();
+		}
+		for (int k = 0; k < size[c]; ++k) {
+			next[cycle[k]] = cycle[(k + 1) % size[c]];
+		}
+	}
+	for (int v = 0; v < n; ++v) {
+		if (!visited[v]) {
+			unvisited.push_back(v);
+		}
+	}
+
+	auto cost = [&](int a, int u) {
+		return get_expansion_cost(a, next[a], u);
+	};
+	auto offer = [&](int c, int u, int a) {
+		Insertion insertion{static_cast<int>(cost(a, u)), a};
+		if (best[c][u].edge < 0 || insertion.cost < best[c][u].cost) {
+			second[c][u] = best[c][u];
+			best[c][u] = insertion;
+		} else if (second[c][u].edge < 0 ||
+				   insertion.cost < second[c][u].cost) {
+			second[c][u] = insertion;
+		}
+	};
+	auto scan = [&](int c, int u) {
+		best[c][u] = second[c][u] = Insertion();
+		if (head[c] < 0) {
+			return;
+		}
+		int a = head[c];
+		do {
+			offer(c, u, a);
+			a = next[a];
+		} while (a != head[c]);
+	};
+
+	std::vector<double> regret[2] = {std::vector<double>(n),
+									 std::vector<double>(n)};
+	auto update_regret = [&](int c, int u) {
+		// a cycle of one vertex has a single edge; its regret is -coef * best
+		const int second_cost =
+			second[c][u].edge < 0 ? best[c][u].cost : second[c][u].cost;
+		regret[c][u] = second_cost - best[c][u].cost - coef * best[c][u].cost;
+	};
+	// Updates the insertions of u into cycle c after v was inserted after a
+	// (a = -1 - the cycle was empty or nothing is cached yet); false if
+	// they did not change.
+	auto refresh = [&](int c, int a, int v, int u) {
+		if (a < 0 || best[c][u].edge == a || second[c][u].edge == a) {
+			scan(c, u);
+		} else {
+			const Insertion previous_best = best[c][u],
+							previous_second = second[c][u];
+			offer(c, u, a);
+			offer(c, u, v);
+			if (best[c][u].cost == previous_best.cost &&
+				best[c][u].edge == previous_best.edge &&
+				second[c][u].cost == previous_second.cost) {
+				return false;
+			}
+		}
+		update_regret(c, u);
+		return true;
+	};
+
+	const bool parallel = params.threads > 1;
+	constexpr int block = 256;
+	std::vector<int> block_best;
+	// Refreshes every unvisited vertex in cycle c (both cycles for c = -1)
+	// and returns the vertex to insert into cycle next_c, -1 when done.
+	auto refresh_all = [&](int c, int a, int v, int next_c) {
+		if (!parallel) {
+			for (int u : unvisited) {
+				for (int d = 0; d < 2; ++d) {
+					if ((c < 0 || c == d) && refresh(d, a, v, u)) {
+						regrets[d].set(u, regret[d][u]);
+					}
+				}
+			}
+			return regrets[next_c].empty() ? -1 : regrets[next_c].top();
+		}
+		auto before = [&](int x, int y) {
+			return y < 0 || regret[next_c][x] > regret[next_c][y] ||
+				   (regret[next_c][x] == regret[next_c][y] && x < y);
+		};
+		const int tasks = (unvisited.size() + block - 1) / block;
+		block_best.assign(tasks, -1);
+		run_tasks(tasks, [&](int t) {
+			const int last = std::min<int>((t + 1) * block, unvisited.size());
+			for (int k = t * block; k < last; ++k) {
+				const int u = unvisited[k];
+				for (int d = 0; d < 2; ++d) {
+					if (c < 0 || c == d) {
+						refresh(d, a, v, u);
+					}
+				}
+				if (before(u, block_best[t])) {
+					block_best[t] = u;
+				}
+			}
+		});
+		int chosen = -1;
+		for (int u : block_best) {
+			if (before(u, chosen)) {
+				chosen = u;
+			}
+		}
+		return chosen;
+	};
+
+	int v = refresh_all(-1, -1, -1, size[0] <= size[1] ? 0 : 1);
+	while (v >= 0) {
+		const int c = size[0] <= size[1] ? 0 : 1;
+		unvisited.erase(std::find(unvisited.begin(), unvisited.end(), v));
+		if (!parallel) {
+			regrets[0].erase(v);
+			regrets[1].erase(v);
+		}
+		visited[v] = true;
+
+		const int a = best[c][v].edge;
+		if (a < 0) { // empty cycle
+			next[v] = v;
+			head[c] = v;
+		} else {
+			next[v] = next[a];
+			next[a] = v;
+		}
+		++size[c];
+		v = refresh_all(c, a, v, size[0] <= size[1] ? 0 : 1);
+	}
+
+	for (int c = 0; c < 2; ++c) {
+		std::vector<int> &cycle = c == 0 ? c1 : c2;
+		cycle.clear();
+		if (head[c] < 0) {
+			continue;
+		}
+		int a = head[c];
+		do {
+			cycle.push_back(a);
+			a = next[a];
+		} while (a != head[c]);
+	}
+}
+
+INSTANTIATE_TSP
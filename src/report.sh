@@ -3,7 +3,7 @@
 declare -a ALGO_TYPES=("nearest" "expansion" "regret" "local" "random_walk" "msls" "ils1" "ils2" "hea")
 declare -a MOVEMENTS_TYPES=("edge" "vertex")
 declare -a STEEPEST=("0" "1") # greedy - 0 / steepest - 1
-declare -a INPUT_DATA=("random" "regret")
+declare -a INPUT_DATA=("random" "regret" "split")
 declare -a LOCAL_SEARCH=("0" "1")
 
 
@@ -71,7 +71,7 @@ else
     cycles_file="../cycles/${algotype}_${input_data}_${movements_type}_${_steepest}_${instance_path::-4}.txt"
 fi
    
-g++ -o main.out main.cpp matrix.cpp tsp.cpp greedy.cpp local_search.cpp local_search_ext.cpp hea.cpp
+g++ -O2 -march=native -pthread -o main.out main.cpp instance.cpp matrix.cpp cache.cpp neighbors.cpp thread_pool.cpp tour.cpp indexed_heap.cpp fragments.cpp tsp.cpp split.cpp greedy.cpp regret.cpp local_search.cpp local_search_segments.cpp local_search_ext.cpp hea.cpp
 
 for ((i=1; i<=$N; i++)); do
     cpp_output=$(./main.out "$instance_path" "$algotype" "$input_data" "$movements_type" "$steepest" "$local_search")
@@ -0,0 +1,103 @@
+#!/bin/bash
+# Smoke test: builds main.out with -DCHECK_DELTAS (list_search aborts when an
+# applied move does not change the cycles by its stored delta), generates
+# small random instances and checks that every run prints two cycles that
+# together cover each vertex exactly once.
+#
+# Usage: ./smoke_test.sh [seeds (default 20)]
+
+set -e
+seeds="${1:-20}"
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+g++ -O2 -march=native -pthread -DCHECK_DELTAS -o "$tmp/main.out" main.cpp instance.cpp matrix.cpp cache.cpp neighbors.cpp thread_pool.cpp tour.cpp indexed_heap.cpp fragments.cpp tsp.cpp split.cpp greedy.cpp regret.cpp local_search.cpp local_search_segments.cpp local_search_ext.cpp hea.cpp
+
+# euc_instance <file> <nodes> <seed>
+euc_instance() {
+    awk -v n="$2" -v seed="$3" 'BEGIN {
+        srand(seed)
+        print "NAME: smoke"; print "TYPE: TSP"; print "DIMENSION: " n
+        print "EDGE_WEIGHT_TYPE: EUC_2D"; print "NODE_COORD_SECTION"
+        for (i = 1; i <= n; ++i) print i, int(rand() * 1000), int(rand() * 1000)
+        print "EOF"
+    }' > "$1"
+}
+
+# explicit_instance <file> <nodes> <seed>: FULL_MATRIX of rounded euclidean
+# distances, so no coordinates reach the solver
+explicit_instance() {
+    awk -v n="$2" -v seed="$3" 'BEGIN {
+        srand(seed)
+        print "NAME: smoke"; print "TYPE: TSP"; print "DIMENSION: " n
+        print "EDGE_WEIGHT_TYPE: EXPLICIT"; print "EDGE_WEIGHT_FORMAT: FULL_MATRIX"
+        print "EDGE_WEIGHT_SECTION"
+        for (i = 1; i <= n; ++i) { x[i] = int(rand() * 1000); y[i] = int(rand() * 1000) }
+        for (i = 1; i <= n; ++i) {
+            row = ""
+            for (j = 1; j <= n; ++j) row = row " " int(sqrt((x[i] - x[j]) ^ 2 + (y[i] - y[j]) ^ 2) + 0.5)
+            print row
+        }
+        print "EOF"
+    }' > "$1"
+}
+
+failed=0
+# check <instance> <nodes> <args...>
+check() {
+    local instance="$1" n="$2"
+    shift 2
+    local output
+    if ! output=$("$tmp/main.out" "$instance" "$@" 2>&1); then
+        echo "FAIL ($instance $*): exit code"
+        echo "$output" | tail -3
+        failed=1
+        return
+    fi
+    # the last two lines are the cycles
+    if ! echo "$output" | tail -2 | awk -v n="$n" '
+        { for (k = 1; k <= NF; ++k) { if ($k < 1 || $k > n || seen[$k]++) exit 1; ++count } }
+        END { exit count != n }'; then
+        echo "FAIL ($instance $*): cycles do not cover the instance"
+        failed=1
+    fi
+}
+
+for ((seed = 1; seed <= seeds; ++seed)); do
+    euc_instance "$tmp/euc.tsp" 100 "$seed"
+    for input in random regret; do
+        check "$tmp/euc.tsp" 100 local "$input" edge 1 --move_list=1 --seed="$seed"
+    done
+done
+
+# odd number of vertices: the cycles differ in size by one
+euc_instance "$tmp/odd.tsp" 99 1
+for input in random regret split; do
+    check "$tmp/odd.tsp" 99 local "$input" edge 0
+    check "$tmp/odd.tsp" 99 local "$input" vertex 1
+    check "$tmp/odd.tsp" 99 local "$input" edge 1 --or_opt=1 --cross_exchange=4
+done
+check "$tmp/odd.tsp" 99 local random edge 1 --delta_cache=1 --or_opt=1
+check "$tmp/odd.tsp" 99 local random edge 1 --candidates=8 --or_opt=1 --cross_exchange=4
+check "$tmp/odd.tsp" 99 local random edge 1 --move_list=1
+check "$tmp/odd.tsp" 99 local random edge 0 --dont_look=1
+
+# EXPLICIT: the first run parses the file, the second reads the cache
+explicit_instance "$tmp/explicit.tsp" 60 1
+for pass in parse cache; do
+    for algorithm in nearest expansion regret; do
+        check "$tmp/explicit.tsp" 60 "$algorithm"
+    done
+    for input in random regret split; do
+        check "$tmp/explicit.tsp" 60 local "$input" edge 1
+        check "$tmp/explicit.tsp" 60 local "$input" vertex 0
+    done
+    check "$tmp/explicit.tsp" 60 local regret edge 1 --candidates=5
+    check "$tmp/explicit.tsp" 60 local regret edge 1 --move_list=1
+    check "$tmp/explicit.tsp" 60 local regret edge 0 --dont_look=1
+done
+
+if [ "$failed" -ne 0 ]; then
+    exit 1
+fi
+echo "OK"
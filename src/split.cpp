@@ -0,0 +1,99 @@
+#include "../lib/tsp.h"
+
+// Position of cell (x, y) along the Hilbert curve over a 2^16 x 2^16 grid.
+static uint64_t hilbert_index(uint32_t x, uint32_t y) {
+	uint64_t index = 0;
+	for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+		uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+		index += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+		if (ry == 0) {
+			if (rx == 1) {
+				x = s - 1 - (x & (s - 1));
+				y = s - 1 - (y & (s - 1));
+			}
+			std::swap(x, y);
+		}
+	}
+	return index;
+}
+
+// Starting cycles for input_data "split": the vertices are cut into two
+// balanced spatial clusters and each cluster is toured along the Hilbert
+// curve. The first cut is a median cut across a random direction, so
+// every start differs; then a few balanced 2-means steps move it - with
+// squared distances the best balanced split for two centroids is again a
+// median cut, across the line joining them. Instances without coordinates
+// (EXPLICIT) get random cycles.
+template <typename MatrixT>
+auto TSP<MatrixT>::generate_split_cycles()
+	-> std::tuple<std::vector<int>, std::vector<int>> {
+	const int n = dist_matrix.size();
+	const std::vector<double> &x = dist_matrix.x_coord, &y = dist_matrix.y_coord;
+	if (x.empty()) {
+		return generate_random_cycles(n);
+	}
+	const int first_size = n - n / 2;
+
+	std::vector<int> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::vector<double> key(n);
+	// the first_size vertices with the smallest key form the first cluster
+	auto cut = [&](double dx, double dy) {
+		for (int v = 0; v < n; ++v) {
+			key[v] = x[v] * dx + y[v] * dy;
+		}
+		std::nth_element(order.begin(), order.begin() + first_size,
+						 order.end(),
+						 [&](int a, int b) { return key[a] < key[b]; });
+	};
+	std::uniform_real_distribution<double> angle(0, M_PI);
+	const double theta = angle(rng);
+	cut(std::cos(theta), std::sin(theta));
+
+	for (int step = 0; step < 8; ++step) {
+		double centroid[2][2] = {{0, 0}, {0, 0}};
+		for (int k = 0; k < n; ++k) {
+			const int c = k < first_size ? 0 : 1;
+			centroid[c][0] += x[order[k]];
+			centroid[c][1] += y[order[k]];
+		}
+		for (int c = 0; c < 2; ++c) {
+			const int size = c == 0 ? first_size : n - first_size;
+			centroid[c][0] /= std::max(size, 1);
+			centroid[c][1] /= std::max(size, 1);
+		}
+		std::vector<int> previous(order.begin(), order.begin() + first_size);
+		cut(centroid[1][0] - centroid[0][0], centroid[1][1] - centroid[0][1]);
+		std::vector<int> current(order.begin(), order.begin() + first_size);
+		std::sort(previous.begin(), previous.end());
+		std::sort(current.begin(), current.end());
+		if (previous == current) {
+			break;
+		}
+	}
+
+	// The curve is laid over the points turned by a random angle, so the
+	// tours differ between starts as well.
+	const double phi = 2 * angle(rng);
+	std::vector<double> u(n), w(n);
+	for (int v = 0; v < n; ++v) {
+		u[v] = x[v] * std::cos(phi) - y[v] * std::sin(phi);
+		w[v] = x[v] * std::sin(phi) + y[v] * std::cos(phi);
+	}
+	auto [lo_u, hi_u] = std::minmax_element(u.begin(), u.end());
+	auto [lo_w, hi_w] = std::minmax_element(w.begin(), w.end());
+	const double scale =
+		65535 / std::max({*hi_u - *lo_u, *hi_w - *lo_w, 1e-9});
+	std::vector<uint64_t> curve(n);
+	for (int v = 0; v < n; ++v) {
+		curve[v] = hilbert_index((uint32_t)((u[v] - *lo_u) * scale),
+								 (uint32_t)((w[v] - *lo_w) * scale));
+	}
+	auto along_curve = [&](int a, int b) { return curve[a] < curve[b]; };
+	std::sort(order.begin(), order.begin() + first_size, along_curve);
+	std::sort(order.begin() + first_size, order.end(), along_curve);
+	return {std::vector<int>(order.begin(), order.begin() + first_size),
+			std::vector<int>(order.begin() + first_size, order.end())};
+}
+
+INSTANTIATE_TSP
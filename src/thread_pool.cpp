@@ -0,0 +1,59 @@
+#include "../lib/thread_pool.h"
+
+ThreadPool::ThreadPool(int threads) {
+	for (int t = 1; t < threads; t++) {
+		workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	wake.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::run(int count, const std::function<void(int)> &f) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = &f;
+		tasks = count;
+		next_task = 0;
+		busy = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+	take_tasks();
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busy == 0; });
+}
+
+void ThreadPool::take_tasks() {
+	int t;
+	while ((t = next_task.fetch_add(1)) < tasks) {
+		(*task)(t);
+	}
+}
+
+void ThreadPool::work() {
+	long seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stop || generation != seen; });
+			if (stop) {
+				return;
+			}
+			seen = generation;
+		}
+		take_tasks();
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busy == 0) {
+			done.notify_one();
+		}
+	}
+}
@@ -0,0 +1,143 @@
+#include "../lib/tour.h"
+#include <algorithm>
+#include <cmath>
+
+Tour::Tour(const std::vector<int> &order, int vertices)
+	: segment_of(vertices, -1), index_of(vertices, 0) {
+	build(order);
+}
+
+// Cuts the tour into segments of about sqrt(n) vertices.
+void Tour::build(const std::vector<int> &order) {
+	count = order.size();
+	const int length = std::max(1, (int)std::sqrt((double)count));
+	segments.clear();
+	sequence.clear();
+	for (int first = 0; first < count; first += length) {
+		int s = segments.size();
+		Segment segment;
+		segment.rank = s;
+		segment.vertices.assign(order.begin() + first,
+								order.begin() + std::min(first + length, count));
+		for (int k = 0; k < segment.vertices.size(); ++k) {
+			segment_of[segment.vertices[k]] = s;
+			index_of[segment.vertices[k]] = k;
+		}
+		segments.push_back(std::move(segment));
+		sequence.push_back(s);
+	}
+	max_segments = 2 * segments.size() + 4;
+}
+
+int Tour::next(int v) const {
+	const int s = segment_of[v], k = offset(v);
+	if (k + 1 < segments[s].vertices.size()) {
+		return at(s, k + 1);
+	}
+	return at(sequence[(segments[s].rank + 1) % sequence.size()], 0);
+}
+
+int Tour::prev(int v) const {
+	const int s = segment_of[v], k = offset(v);
+	if (k > 0) {
+		return at(s, k - 1);
+	}
+	int p = sequence[(segments[s].rank - 1 + sequence.size()) % sequence.size()];
+	return at(p, segments[p].vertices.size() - 1);
+}
+
+bool Tour::between(int a, int b, int c) const {
+	long long ka = key(a), kb = key(b), kc = key(c);
+	if (ka <= kc) {
+		return ka <= kb && kb <= kc;
+	}
+	return kb >= ka || kb <= kc;
+}
+
+// Makes v the first vertex (in tour direction) of its segment; the part from
+// v on becomes a new segment right after the old one.
+void Tour::split(int v) {
+	const int s = segment_of[v], k = offset(v);
+	if (k == 0) {
+		return;
+	}
+	const int t = segments.size();
+	segments.emplace_back();
+	Segment &head = segments[s], &tail = segments[t];
+	std::vector<int> &vertices = head.vertices;
+	const int size = vertices.size();
+	tail.reversed = head.reversed;
+	if (!head.reversed) {
+		tail.vertices.assign(vertices.begin() + k, vertices.end());
+		vertices.resize(k);
+	} else {
+		tail.vertices.assign(vertices.begin(), vertices.begin() + size - k);
+		vertices.erase(vertices.begin(), vertices.begin() + size - k);
+		for (int i = 0; i < vertices.size(); ++i) {
+			index_of[vertices[i]] = i;
+		}
+	}
+	for (int i = 0; i < tail.vertices.size(); ++i) {
+		segment_of[tail.vertices[i]] = t;
+		index_of[tail.vertices[i]] = i;
+	}
+	sequence.insert(sequence.begin() + head.rank + 1, t);
+	for (int r = head.rank + 1; r < sequence.size(); ++r) {
+		segments[sequence[r]].rank = r;
+	}
+}
+
+void Tour::reverse(int a, int b) {
+	if (a == b) {
+		return;
+	}
+	// Reversing the complementary path gives the same cycle; one of the two
+	// does not wrap around the end of the segment sequence.
+	if (key(a) > key(b)) {
+		int after = next(b), before = prev(a);
+		if (after == a) {
+			return; // the whole tour
+		}
+		a = after;
+		b = before;
+	}
+	split(a);
+	split(next(b)); // no-op when b ends the last segment
+	const int first = segments[segment_of[a]].rank;
+	const int last = segments[segment_of[b]].rank;
+	std::reverse(sequence.begin() + first, sequence.begin() + last + 1);
+	for (int r = first; r <= last; ++r) {
+		Segment &segment = segments[sequence[r]];
+		segment.rank = r;
+		segment.reversed = !segment.reversed;
+	}
+	if (sequence.size() > max_segments) {
+		build(order());
+	}
+}
+
+void Tour::replace(int v, int u) {
+	const int s = segment_of[v], i = index_of[v];
+	segments[s].vertices[i] = u;
+	segment_of[u] = s;
+	index_of[u] = i;
+	segment_of[v] = -1;
+}
+
+void Tour::swap(int u, int v) {
+	std::swap(segments[segment_of[u]].vertices[index_of[u]],
+			  segments[segment_of[v]].vertices[index_of[v]]);
+	std::swap(segment_of[u], segment_of[v]);
+	std::swap(index_of[u], index_of[v]);
+}
+
+std::vector<int> Tour::order() const {
+	std::vector<int> result;
+	result.reserve(count);
+	for (int s : sequence) {
+		for (int k = 0; k < segments[s].vertices.size(); ++k) {
+			result.push_back(at(s, k));
+		}
+	}
+	return result;
+}
@@ -1,20 +1,33 @@
 #include "../lib/tsp.h"
 
-TSP::TSP(const Matrix &dist_matrix, AlgType alg_type)
+template <typename MatrixT>
+TSP<MatrixT>::TSP(const MatrixT &dist_matrix, AlgType alg_type)
 	: dist_matrix(dist_matrix), alg_type(alg_type) {}
 
-TSP::TSP(const Matrix &dist_matrix, AlgType alg_type, std::string input_data,
+template <typename MatrixT>
+TSP<MatrixT>::TSP(const MatrixT &dist_matrix, AlgType alg_type, std::string input_data,
 		 std::string movements_type, int steepest, std::string filename)
 	: dist_matrix(dist_matrix), alg_type(alg_type),
 	  params({input_data, movements_type, filename, steepest}) {}
 
 	
-TSP::TSP(const Matrix &dist_matrix, AlgType alg_type, std::string input_data,
+template <typename MatrixT>
+TSP<MatrixT>::TSP(const MatrixT &dist_matrix, AlgType alg_type, std::string input_data,
 		 std::string movements_type, int steepest, int using_local_search, std::string filename)
 	: dist_matrix(dist_matrix), alg_type(alg_type),
 	  params({input_data, movements_type, filename, steepest, using_local_search}) {}  
 
-auto TSP::solve() -> std::tuple<std::vector<int>, std::vector<int>> {
+template <typename MatrixT>
+TSP<MatrixT>::TSP(const MatrixT &dist_matrix, AlgType alg_type,
+				  LocalSearchParams params)
+	: dist_matrix(dist_matrix), alg_type(alg_type), params(std::move(params)) {
+	if (this->params.seed != 0) {
+		rng.seed(this->params.seed);
+	}
+}
+
+template <typename MatrixT>
+auto TSP<MatrixT>::solve() -> std::tuple<std::vector<int>, std::vector<int>> {
 	switch (alg_type) {
 	case AlgType::nearest_neighbors:
 		return find_greedy_cycles_nearest();
@@ -39,19 +52,19 @@ auto TSP::solve() -> std::tuple<std::vector<int>, std::vector<int>> {
 	return {cycle1, cycle2};
 }
 
-int TSP::find_random_start() {
-	// return rand() % dist_matrix.x_coord.size();
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<int> dist(0, dist_matrix.x_coord.size() - 1);
-	return dist(gen);
+template <typename MatrixT>
+int TSP<MatrixT>::find_random_start() {
+	// return rand() % dist_matrix.size();
+	std::uniform_int_distribution<int> dist(0, dist_matrix.size() - 1);
+	return dist(rng);
 }
 
-int TSP::find_farthest(int node) {
+template <typename MatrixT>
+int TSP<MatrixT>::find_farthest(int node) {
 	int farthest_node = -1;
 	double max_distance = -1.0;
 
-	for (size_t i = 0; i < dist_matrix.x_coord.size(); ++i) {
+	for (size_t i = 0; i < dist_matrix.size(); ++i) {
 		if (i != node) {
 			double distance = calc_distance(node, i);
 
@@ -65,23 +78,25 @@ int TSP::find_farthest(int node) {
 	return farthest_node;
 }
 
-int TSP::calc_distance(int v1, int v2) {
-	return std::sqrt(
-		std::pow(dist_matrix.x_coord[v2] - dist_matrix.x_coord[v1], 2) +
-		std::pow(dist_matrix.y_coord[v2] - dist_matrix.y_coord[v1], 2));
+template <typename MatrixT>
+int TSP<MatrixT>::calc_distance(int v1, int v2) {
+	return dist_matrix(v1, v2);
 }
 
-void TSP::append_vertex(int v, std::vector<int> &cycle) {
+template <typename MatrixT>
+void TSP<MatrixT>::append_vertex(int v, std::vector<int> &cycle) {
 	cycle.push_back(v);
 	visited[v] = true;
 }
 
-void TSP::insert_vertex(int v, int pos, std::vector<int> &cycle) {
+template <typename MatrixT>
+void TSP<MatrixT>::insert_vertex(int v, int pos, std::vector<int> &cycle) {
 	cycle.insert(cycle.begin() + pos, v);
 	visited[v] = true;
 }
 
-void TSP::log_build_process() {
+template <typename MatrixT>
+void TSP<MatrixT>::log_build_process() {
 	std::cout << "TSP Cycle 1: ";
 	for (size_t vertex : cycle1) {
 		std::cout << vertex + 1 << " ";
@@ -96,35 +111,56 @@ void TSP::log_build_process() {
 	std::cout << "-----------------" << std::endl;
 }
 
-std::pair<int, int> TSP::choose_starting_vertices() {
+template <typename MatrixT>
+std::pair<int, int> TSP<MatrixT>::choose_starting_vertices() {
 	int start1 =
 		(this->start_idx == -1) ? find_random_start() : this->start_idx;
 	int start2 = find_farthest(start1);
 	return {start1, start2};
 }
 
-double TSP::calc_cycles_len() {
+// Calls task(t) for every t in [0, count), on the thread pool when
+// params.threads > 1.
+template <typename MatrixT>
+void TSP<MatrixT>::run_tasks(int count,
+							 const std::function<void(int)> &task) {
+	if (params.threads <= 1) {
+		for (int t = 0; t < count; ++t) {
+			task(t);
+		}
+		return;
+	}
+	if (!pool) {
+		pool = std::make_shared<ThreadPool>(params.threads);
+	}
+	pool->run(count, task);
+}
+
+template <typename MatrixT>
+double TSP<MatrixT>::calc_cycles_len() {
 	int len1 = 0;
 	int len2 = 0;
 	for (int i = 0; i < cycle1.size(); ++i) {
 		len1 += calc_distance(cycle1[i], cycle1[(i + 1) % cycle1.size()]);
+	}
+	for (int i = 0; i < cycle2.size(); ++i) {
 		len2 += calc_distance(cycle2[i], cycle2[(i + 1) % cycle2.size()]);
 	}
 	return len1 + len2;
 }
 
-auto TSP::generate_random_cycles(int n)
+template <typename MatrixT>
+auto TSP<MatrixT>::generate_random_cycles(int n)
 	-> std::tuple<std::vector<int>, std::vector<int>> {
 	std::vector<int> values(n);
 	for (int i = 0; i < n; ++i)
 		values[i] = i;
 
-	std::random_device rd;
-	std::mt19937 g(rd());
-	std::shuffle(values.begin(), values.end(), g);
+	std::shuffle(values.begin(), values.end(), rng);
 
-	std::vector<int> c1(values.begin(), values.begin() + (int)(n / 2));
-	std::vector<int> c2(values.begin() + n - (int)(n / 2), values.end());
+	// for odd n the first cycle gets the extra vertex
+	std::vector<int> c1(values.begin(), values.begin() + n - n / 2);
+	std::vector<int> c2(values.begin() + n - n / 2, values.end());
 
 	return {c1, c2};
 }
@@ -175,7 +211,8 @@ auto calculateAverageFromFile(std::ifstream &file) {
 	return target_time;
 }
 
-std::chrono::steady_clock::time_point TSP::calculateAverageMSLStime() {
+template <typename MatrixT>
+std::chrono::steady_clock::time_point TSP<MatrixT>::calculateAverageMSLStime() {
 
 	// Find the average time from the file
 	std::string algo = "msls";
@@ -207,20 +244,24 @@ std::chrono::steady_clock::time_point TSP::calculateAverageMSLStime() {
 }
 
 // Function to calculate objective value of the cycle
-int TSP::calculate_objective(const std::vector<int> &c1,
+template <typename MatrixT>
+int TSP<MatrixT>::calculate_objective(const std::vector<int> &c1,
 							 const std::vector<int> &c2) {
 	int objective_value = 0;
 	for (size_t i = 0; i < c1.size(); ++i) {
 		objective_value +=
-			dist_matrix.dist_matrix[c1[i]][c1[(i + 1) % c1.size()]];
+			dist_matrix(c1[i], c1[(i + 1) % c1.size()]);
+	}
+	for (size_t i = 0; i < c2.size(); ++i) {
 		objective_value +=
-			dist_matrix.dist_matrix[c2[i]][c2[(i + 1) % c2.size()]];
+			dist_matrix(c2[i], c2[(i + 1) % c2.size()]);
 	}
 
 	return objective_value;
 }
 
-void TSP::save_data(const std::string& prefix, long data, struct LocalSearchParams params, std::string algo) {
+template <typename MatrixT>
+void TSP<MatrixT>::save_data(const std::string& prefix, long data, struct LocalSearchParams params, std::string algo) {
 	std::string steepest = (params.steepest == 1) ? "steepest" : "greedy";
 	std::string local = (params.using_local_search == 1) ? "local" : "nolocal";
 	std::string cycles_time_file;
@@ -243,4 +284,6 @@ void TSP::save_data(const std::string& prefix, long data, struct LocalSearchPara
 	std::ofstream outfile(cycles_time_file, std::ios_base::app);
 	outfile << data << std::endl;
 	outfile.close();
-}
\ No newline at end of file
+}
+
+INSTANTIATE_TSP
@@ -1,11 +0,0 @@
-#include "../lib/utils.h"
-
-std::vector<std::string> splitString(const std::string &str, char delimiter) {
-	std::vector<std::string> tokens;
-	std::stringstream ss(str);
-	std::string token;
-	while (std::getline(ss, token, delimiter)) {
-		tokens.push_back(token);
-	}
-	return tokens;
-}
\ No newline at end of file